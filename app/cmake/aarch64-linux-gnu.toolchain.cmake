@@ -0,0 +1,36 @@
+# cross build of the physics core and femsim for 64-bit ARM Linux, which selects the NEON kernels
+# of arm64-v8a like the Android build. the binary runs on an aarch64 board or under qemu-aarch64:
+#   cmake -S app -B build-aarch64 -DCMAKE_TOOLCHAIN_FILE=app/cmake/aarch64-linux-gnu.toolchain.cmake
+#   cmake --build build-aarch64
+#   qemu-aarch64 -L /usr/aarch64-linux-gnu build-aarch64/femsim --kernels neon --validate 20 model.tetbin
+# clang is used when it is found, otherwise the aarch64-linux-gnu GNU toolchain. SYSROOT points at the
+# target libraries if they are not in the default location of the cross toolchain.
+# the Android NDK build instead passes its own toolchain file and ANDROID_ABI=arm64-v8a
+
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR aarch64)
+
+set(CROSS_TRIPLE aarch64-linux-gnu)
+
+find_program(CROSS_CLANG clang)
+
+if(CROSS_CLANG)
+    set(CMAKE_C_COMPILER clang)
+    set(CMAKE_CXX_COMPILER clang++)
+    set(CMAKE_C_COMPILER_TARGET ${CROSS_TRIPLE})
+    set(CMAKE_CXX_COMPILER_TARGET ${CROSS_TRIPLE})
+else()
+    set(CMAKE_C_COMPILER ${CROSS_TRIPLE}-gcc)
+    set(CMAKE_CXX_COMPILER ${CROSS_TRIPLE}-g++)
+endif()
+
+if(SYSROOT)
+    set(CMAKE_SYSROOT ${SYSROOT})
+endif()
+
+# programs run on the host, libraries come from the target. Eigen is headers only, so the host copy
+# is fine when the sysroot has none
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE BOTH)
+set(CMAKE_FIND_ROOT_PATH_MODE_PACKAGE ONLY)
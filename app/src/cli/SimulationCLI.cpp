@@ -0,0 +1,316 @@
+// headless simulation on the host: loads a .tetbin, runs a number of substeps on the calling thread
+// and prints the throughput and the time spent in every phase of the substep.
+// usage: femsim [options] path/to/model.tetbin, see printUsage
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "AssetManager.h"
+#include "Physics.h"
+
+#include "exceptionUtils.h"
+
+extern "C" {
+#include "generalUtils.h"
+}
+
+using namespace std;
+
+//gravity from a substep on, until the next keyframe
+struct GravityKeyframe {
+    long step;
+    EigenVector3 gravity;
+};
+
+struct Options {
+    long steps = 1000;
+    int bodyCount = 1;
+    string assetsDir;
+    string assetName;
+    string cacheDir;
+    string dumpFile;
+    vector<GravityKeyframe> gravity;
+    PhysicsConfig config;
+};
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "usage: %s [options] model.tetbin\n"
+            "  --steps N                substeps to run (1000)\n"
+            "  --threads N              threads of the substep, 0 for one per core (0)\n"
+            "  --kernels NAME           auto, scalar, sse4, avx2, avx512 or neon (auto)\n"
+            "  --lanes N                tets per batch, 0 for any (0)\n"
+            "  --local-step NAME        fused or split (fused)\n"
+            "  --assembly NAME          scatter or gather (scatter)\n"
+            "  --constraints NAME       gauss-seidel or jacobi (gauss-seidel)\n"
+            "  --ordering NAME          keep, morton or rcm (rcm)\n"
+            "  --bodies N               copies of the model in a grid inside the walls (1)\n"
+            "  --no-instancing          simulate every copy as a block of the batched system\n"
+            "  --material D,E,NU        density, Young's modulus and Poisson ratio\n"
+            "  --gravity X,Y,Z[@STEP]   gravity from substep STEP on (from the start without @STEP), may be\n"
+            "                           repeated. before the first one the app's default of 0,0,-1 applies\n"
+            "  --validate N             compare N substeps with the reference solvers first\n"
+            "  --assets DIR             directory of the model and cube.meshbin (directory of the model)\n"
+            "  --cache DIR              directory of the factorization cache, none if omitted\n"
+            "  --dump FILE              write the final positions, one vertex per line\n",
+            program);
+}
+
+//index of name in names, -1 if it is not one of them
+static int findName(const char* name, const char* const* names, int count) {
+
+    for (int i = 0; i < count; i++)
+        if (strcmp(name, names[i]) == 0)
+            return i;
+
+    return -1;
+}
+
+static bool parseFloats(const char* text, float* values, int count) {
+
+    char* end = nullptr;
+    for (int i = 0; i < count; i++) {
+        values[i] = strtof(text, &end);
+        if (end == text)
+            return false;
+        text = end;
+        if (i + 1 < count) {
+            if (*text != ',')
+                return false;
+            text++;
+        }
+    }
+
+    return true;
+}
+
+static bool parseGravity(const char* text, GravityKeyframe& keyframe) {
+
+    float g[3];
+    if (!parseFloats(text, g, 3))
+        return false;
+
+    keyframe.gravity = EigenVector3(g[0], g[1], g[2]);
+    keyframe.step = 0;
+
+    const char* at = strchr(text, '@');
+    if (at)
+        keyframe.step = atol(at + 1);
+
+    return keyframe.step >= 0;
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+
+    static const char* const kernelNames[] = { "auto", "scalar", "sse4", "avx2", "avx512", "neon" };
+    static const KernelInstructionSet kernelSets[] = { AutoKernels, ScalarKernels, SSE4Kernels, AVX2Kernels, AVX512Kernels, NEONKernels };
+    static const char* const orderingNames[] = { "keep", "morton", "rcm" };
+    static const MeshOrdering orderings[] = { KeepOrdering, MortonOrdering, RCMOrdering };
+
+    string modelPath;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        //every option but the flags takes one value
+        bool flag = strcmp(arg, "--no-instancing") == 0;
+        const char* value = !flag && i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (arg[0] != '-') {
+            modelPath = arg;
+            continue;
+        } else if (flag) {
+            options.config.instanceBodies = false;
+            continue;
+        } else if (!value) {
+            fprintf(stderr, "%s needs a value\n", arg);
+            return false;
+        }
+        i++;
+
+        int index;
+        if (strcmp(arg, "--steps") == 0)
+            options.steps = atol(value);
+        else if (strcmp(arg, "--threads") == 0)
+            options.config.threadCount = atoi(value);
+        else if (strcmp(arg, "--lanes") == 0)
+            options.config.laneWidth = atoi(value);
+        else if (strcmp(arg, "--bodies") == 0)
+            options.bodyCount = atoi(value);
+        else if (strcmp(arg, "--validate") == 0)
+            options.config.validationSteps = atoi(value);
+        else if (strcmp(arg, "--assets") == 0)
+            options.assetsDir = value;
+        else if (strcmp(arg, "--cache") == 0)
+            options.cacheDir = value;
+        else if (strcmp(arg, "--dump") == 0)
+            options.dumpFile = value;
+        else if (strcmp(arg, "--kernels") == 0 && (index = findName(value, kernelNames, 6)) >= 0)
+            options.config.instructionSet = kernelSets[index];
+        else if (strcmp(arg, "--ordering") == 0 && (index = findName(value, orderingNames, 3)) >= 0)
+            options.config.meshOrdering = orderings[index];
+        else if (strcmp(arg, "--local-step") == 0 && strcmp(value, "fused") == 0)
+            options.config.localStep = FusedLocalStep;
+        else if (strcmp(arg, "--local-step") == 0 && strcmp(value, "split") == 0)
+            options.config.localStep = SplitLocalStep;
+        else if (strcmp(arg, "--assembly") == 0 && strcmp(value, "scatter") == 0)
+            options.config.rhsAssembly = ScatterAssembly;
+        else if (strcmp(arg, "--assembly") == 0 && strcmp(value, "gather") == 0)
+            options.config.rhsAssembly = GatherAssembly;
+        else if (strcmp(arg, "--constraints") == 0 && strcmp(value, "gauss-seidel") == 0)
+            options.config.volumeConstraints = GaussSeidelConstraints;
+        else if (strcmp(arg, "--constraints") == 0 && strcmp(value, "jacobi") == 0)
+            options.config.volumeConstraints = JacobiConstraints;
+        else if (strcmp(arg, "--material") == 0) {
+            float m[3];
+            if (!parseFloats(value, m, 3)) {
+                fprintf(stderr, "invalid material %s\n", value);
+                return false;
+            }
+            options.config.material.density = m[0];
+            options.config.material.youngsModulus = m[1];
+            options.config.material.poissonRatio = m[2];
+        } else if (strcmp(arg, "--gravity") == 0) {
+            GravityKeyframe keyframe;
+            if (!parseGravity(value, keyframe)) {
+                fprintf(stderr, "invalid gravity %s\n", value);
+                return false;
+            }
+            options.gravity.push_back(keyframe);
+        } else {
+            fprintf(stderr, "unknown option %s %s\n", arg, value);
+            return false;
+        }
+    }
+
+    if (modelPath.empty() || options.steps < 0 || options.bodyCount < 1) {
+        fprintf(stderr, "a model and a positive number of bodies are needed\n");
+        return false;
+    }
+
+    size_t slash = modelPath.find_last_of('/');
+    options.assetName = slash == string::npos ? modelPath : modelPath.substr(slash + 1);
+    if (options.assetsDir.empty())
+        options.assetsDir = slash == string::npos ? "." : modelPath.substr(0, slash);
+
+    std::stable_sort(options.gravity.begin(), options.gravity.end(),
+                     [](const GravityKeyframe& a, const GravityKeyframe& b) { return a.step < b.step; });
+
+    return true;
+}
+
+//the bodies fill a grid of n x n x n cells inside the walls, scaled down to fit a cell
+static void placeBodies(const Options& options, PhysicsConfig& config) {
+
+    const float wallsSize = 4.3f;
+    int n = 1;
+    while (n * n * n < options.bodyCount)
+        n++;
+
+    const float cell = wallsSize / n;
+
+    config.bodies.resize(options.bodyCount);
+    for (int b = 0; b < options.bodyCount; b++) {
+        BodyConfig& body = config.bodies[b];
+        body.assetName = options.assetName;
+        body.scale = 1.0f / n;
+        body.position = EigenVector3((b % n + 0.5f) * cell, (b / n % n + 0.5f) * cell, (b / (n * n) + 0.5f) * cell) -
+                EigenVector3(0.5f, 0.5f, 0.5f) * wallsSize;
+    }
+}
+
+static bool dumpPositions(const string& fileName) {
+
+    FILE* fileHandle = fopen(fileName.c_str(), "w");
+    if (fileHandle == nullptr)
+        return false;
+
+    Physics& physics = Physics::getInstance();
+    vector<EigenVector3> x;
+
+    for (int b = 0; b < physics.getBodyCount(); b++) {
+        physics.getBodyPositions(b, x);
+
+        fprintf(fileHandle, "# body %d, %d vertices\n", b, (int) x.size());
+        for (size_t i = 0; i < x.size(); i++)
+            fprintf(fileHandle, "%.7g %.7g %.7g\n", x[i].x(), x[i].y(), x[i].z());
+    }
+
+    fclose(fileHandle);
+    return true;
+}
+
+int main(int argc, char** argv) {
+
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    placeBodies(options, options.config);
+
+    //Physics expects the bodies to load
+    string modelPath = options.assetsDir + "/" + options.assetName;
+    FILE* modelFile = fopen(modelPath.c_str(), "rb");
+    if (modelFile == nullptr) {
+        fprintf(stderr, "could not open %s\n", modelPath.c_str());
+        return 1;
+    }
+    fclose(modelFile);
+
+    AssetManager::getInstance().initialize(options.assetsDir, options.cacheDir);
+
+    Physics& physics = Physics::getInstance();
+    physics.setConfig(options.config);
+    physics.initialize();
+
+    //the solver preparation is not part of the timed substeps
+    double prepareStart = getTime();
+    physics.step(0);
+    double prepareTime = getTime() - prepareStart;
+    physics.resetSubstepTimings();
+
+    //the substeps between two keyframes run in one go
+    double startTime = getTime();
+    long step = 0;
+    size_t keyframe = 0;
+    while (step < options.steps) {
+        while (keyframe < options.gravity.size() && options.gravity[keyframe].step <= step)
+            physics.setGravity(options.gravity[keyframe++].gravity);
+
+        long next = keyframe < options.gravity.size() ? std::min(options.gravity[keyframe].step, options.steps) : options.steps;
+        physics.step((int) (next - step));
+        step = next;
+    }
+    double elapsed = getTime() - startTime;
+
+    const SubstepTimings& timings = physics.getSubstepTimings();
+    const double dt = physics.getCurrentTimeStep();
+    const double perStep = timings.substeps > 0 ? 1.0e6 / timings.substeps : 0.0;
+
+    printf("%d bodies, solver prepared in %.1f ms\n", physics.getBodyCount(), prepareTime * 1000.0);
+    printf("%ld substeps of %.3f ms in %.3f s: %.1f steps/s, %.2fx realtime\n", options.steps, dt * 1000.0, elapsed,
+           elapsed > 0.0 ? options.steps / elapsed : 0.0, elapsed > 0.0 ? options.steps * dt / elapsed : 0.0);
+    printf("  integration         %10.2f us/step\n", timings.integration * perStep);
+    printf("  local step          %10.2f us/step\n", timings.localStep * perStep);
+    printf("  triangular solve    %10.2f us/step\n", timings.triangularSolve * perStep);
+    printf("  volume constraints  %10.2f us/step\n", timings.volumeConstraints * perStep);
+    printf("  publish             %10.2f us/step\n", timings.publish * perStep);
+
+    int result = 0;
+    if (!options.dumpFile.empty() && !dumpPositions(options.dumpFile)) {
+        fprintf(stderr, "could not write %s\n", options.dumpFile.c_str());
+        result = 1;
+    }
+
+    physics.finalize();
+    AssetManager::getInstance().finalize();
+
+    return result;
+}
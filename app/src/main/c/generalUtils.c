@@ -14,4 +14,18 @@ double getTime(void) {
 
 int64_t timeToUSec(double time) {
     return (int64_t)(time * MILLION);
+}
+
+#define FNV_PRIME 1099511628211ULL
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
 }
\ No newline at end of file
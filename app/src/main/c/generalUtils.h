@@ -2,8 +2,14 @@
 #define PEOPLEWATCHER_GENERALUTILS_H
 
 #include <inttypes.h>
+#include <stddef.h>
 
 double getTime(void);
 int64_t timeToUSec(double time);
 
+#define HASH_INITIAL_VALUE 14695981039346656037ULL
+
+// 64 bit FNV-1a of size bytes, continues from hash. start with HASH_INITIAL_VALUE
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash);
+
 #endif //PEOPLEWATCHER_GENERALUTILS_H
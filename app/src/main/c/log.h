@@ -1,8 +1,32 @@
 #ifndef PEOPLEWATCHER_LOG_H
 #define PEOPLEWATCHER_LOG_H
 
+#ifdef __ANDROID__
+
 #include <android/log.h>
 
 #define print_log(level, tag, ...) __android_log_print(level, tag, __VA_ARGS__);
 
+#else
+
+#include <stdio.h>
+
+// the priorities of android/log.h. everything from ANDROID_LOG_INFO on goes to stderr, one line per message
+enum {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT
+};
+
+#define print_log(level, tag, ...) \
+    do { if ((level) >= ANDROID_LOG_INFO) { fprintf(stderr, "%s: ", tag); fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0);
+
+#endif
+
 #endif //PEOPLEWATCHER_LOG_H
@@ -0,0 +1,58 @@
+#include "Arena.h"
+
+#include <malloc.h>
+#include <cstdlib>
+
+#include "exceptionUtils.h"
+
+Arena::Arena() : memory(nullptr), capacity(0), used(0) {
+
+}
+
+Arena::~Arena() {
+    finalize();
+}
+
+void Arena::initialize(size_t capacity) {
+
+    finalize();
+
+    this->memory = (char*) memalign(ALIGNMENT, align(capacity));
+    my_assert(memory != nullptr);
+
+    this->capacity = align(capacity);
+    this->used = 0;
+}
+
+void Arena::finalize() {
+
+    if (memory)
+        free(memory);
+
+    memory = nullptr;
+    capacity = 0;
+    used = 0;
+}
+
+void* Arena::allocateBytes(size_t size) {
+
+    size = align(size);
+    my_assert(used + size <= capacity);
+
+    void* region = memory + used;
+    used += size;
+
+    return region;
+}
+
+size_t Arena::getUsed() const {
+    return this->used;
+}
+
+size_t Arena::getCapacity() const {
+    return this->capacity;
+}
+
+size_t Arena::align(size_t size) {
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
@@ -0,0 +1,48 @@
+#ifndef FEMFORANDROID_ARENA_H
+#define FEMFORANDROID_ARENA_H
+
+#include <cstddef>
+#include <new>
+
+using namespace std;
+
+// one aligned block of memory, regions are handed out one after another and freed all at once.
+// the solver keeps its per-batch records here in traversal order, so the hot loops walk
+// through a single contiguous buffer instead of chasing pointers to many small allocations
+class Arena {
+private:
+    char* memory;
+    size_t capacity;
+    size_t used;
+public:
+    // every region starts on a cache line
+    static const size_t ALIGNMENT = 64;
+
+    Arena();
+    ~Arena();
+
+    Arena(Arena const&) = delete;
+    void operator=(Arena const&) = delete;
+
+    // capacity has to cover the aligned sizes of all regions allocated afterwards
+    void initialize(size_t capacity);
+    void finalize();
+
+    // returns count default constructed objects
+    template <typename T>
+    T* allocate(size_t count) {
+        T* region = (T*) allocateBytes(count * sizeof(T));
+        for (size_t i = 0; i < count; i++)
+            new (region + i) T();
+        return region;
+    }
+
+    size_t getUsed() const;
+    size_t getCapacity() const;
+
+    static size_t align(size_t size);
+private:
+    void* allocateBytes(size_t size);
+};
+
+#endif //FEMFORANDROID_ARENA_H
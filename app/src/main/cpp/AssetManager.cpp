@@ -6,12 +6,17 @@
 #include "log.h"
 #include "exceptionUtils.h"
 
+extern "C" {
+#include "generalUtils.h"
+}
+
 #define ASSET_MANAGER_TAG "PT_ASSET_MANAGER"
 
 AssetManager::AssetManager() {
 
 }
 
+#ifdef __ANDROID__
 void AssetManager::initialize(AAssetManager* nativeManager, string externalFilesDir) {
 
     if (this->initialized == 1)
@@ -22,6 +27,18 @@ void AssetManager::initialize(AAssetManager* nativeManager, string externalFiles
 
     this->initialized = 1;
 }
+#else
+void AssetManager::initialize(string assetsDir, string externalFilesDir) {
+
+    if (this->initialized == 1)
+        return;
+
+    this->assetsDir = assetsDir;
+    this->externalFilesDir = externalFilesDir;
+
+    this->initialized = 1;
+}
+#endif
 
 void AssetManager::finalize() {
 
@@ -31,30 +48,57 @@ void AssetManager::finalize() {
     this->initialized = 0;
 }
 
-string AssetManager::loadTextAsset(string assertName) {
+bool AssetManager::loadAsset(const string& assetName, vector<unsigned char>& data) {
 
-    AAsset* asset = AAssetManager_open(nativeManager, assertName.c_str(), AASSET_MODE_BUFFER);
+#ifdef __ANDROID__
+    AAsset* asset = AAssetManager_open(nativeManager, assetName.c_str(), AASSET_MODE_BUFFER);
     if (!asset)
-        return "";
-
-    const void* data = AAsset_getBuffer(asset);
-    off64_t size = AAsset_getLength64(asset);
+        return false;
 
-    string result = string(static_cast<const char*>(data), (unsigned int) size);
+    auto buffer = (const unsigned char*)AAsset_getBuffer(asset);
+    data.assign(buffer, buffer + AAsset_getLength64(asset));
 
     AAsset_close(asset);
 
-    return result;
+    return true;
+#else
+    string fullFileName = this->assetsDir + "/" + assetName;
+
+    FILE* fileHandle = fopen(fullFileName.c_str(), "rb");
+    if (fileHandle == nullptr)
+        return false;
+
+    fseek(fileHandle, 0, SEEK_END);
+    long size = ftell(fileHandle);
+    fseek(fileHandle, 0, SEEK_SET);
+
+    data.resize(size > 0 ? (size_t) size : 0);
+    size_t readed = fread(data.data(), 1, data.size(), fileHandle);
+
+    fclose(fileHandle);
+    fileHandle = nullptr;
+
+    return size >= 0 && readed == data.size();
+#endif
+}
+
+string AssetManager::loadTextAsset(string assertName) {
+
+    vector<unsigned char> data;
+    if (!loadAsset(assertName, data))
+        return "";
+
+    return string((const char*) data.data(), data.size());
 }
 
 GLuint AssetManager::loadTextureAsset(string assertName) {
 
-    AAsset* asset = AAssetManager_open(nativeManager, assertName.c_str(), AASSET_MODE_BUFFER);
-    if (!asset)
+    vector<unsigned char> buffer;
+    if (!loadAsset(assertName, buffer))
         return 0;
 
-    auto data = (const unsigned char*)AAsset_getBuffer(asset);
-    off64_t size = AAsset_getLength64(asset);
+    auto data = (const unsigned char*) buffer.data();
+    size_t size = buffer.size();
 
     GLuint textureID = 0;
 
@@ -64,6 +108,7 @@ GLuint AssetManager::loadTextureAsset(string assertName) {
         unsigned int width      = *(unsigned int*)&(data[0x12]);
         unsigned int height     = *(unsigned int*)&(data[0x16]);
 
+#ifdef __ANDROID__
         if (size == 54 + width * height * 3) {
 
             auto pixels = data + dataPos;
@@ -81,24 +126,23 @@ GLuint AssetManager::loadTextureAsset(string assertName) {
 
             glGenerateMipmap(GL_TEXTURE_2D);
         }
+#endif
     }
 
-    AAsset_close(asset);
-
     return textureID;
 }
 
 MeshAsset* AssetManager::loadMeshBinAsset(string assertName, EigenVector3 translation, float scale,
         EigenQuaternion rotation) {
 
-    AAsset* asset = AAssetManager_open(nativeManager, assertName.c_str(), AASSET_MODE_BUFFER);
-    if (!asset)
+    vector<unsigned char> buffer;
+    if (!loadAsset(assertName, buffer))
         return nullptr;
 
-    auto data = (const unsigned char*)AAsset_getBuffer(asset);
-    off64_t size = AAsset_getLength64(asset);
+    auto data = (const unsigned char*) buffer.data();
+    size_t size = buffer.size();
 
-    off64_t vertexCount = size / sizeof(AssetVertex);
+    size_t vertexCount = size / sizeof(AssetVertex);
     my_assert((size % sizeof(AssetVertex)) == 0);
 
     auto result = new MeshAsset();
@@ -133,22 +177,20 @@ MeshAsset* AssetManager::loadMeshBinAsset(string assertName, EigenVector3 transl
         dstVertices++;
     }
 
-    AAsset_close(asset);
-
     return result;
 }
 
 TetAsset* AssetManager::loadTetBinAsset(string assertName, EigenVector3 translation,
-        float scale, EigenQuaternion rotation) {
+        float scale, EigenQuaternion rotation, MeshOrdering ordering) {
 
-    AAsset *asset = AAssetManager_open(nativeManager, assertName.c_str(), AASSET_MODE_BUFFER);
-    if (!asset)
+    vector<unsigned char> buffer;
+    if (!loadAsset(assertName, buffer))
         return nullptr;
 
     TetAsset* result = nullptr;
 
-    auto data = (const unsigned char *) AAsset_getBuffer(asset);
-    off64_t size = AAsset_getLength64(asset);
+    auto data = (const unsigned char *) buffer.data();
+    size_t size = buffer.size();
 
 #pragma pack(push, 1)
     struct BinaryVertex {
@@ -200,6 +242,11 @@ TetAsset* AssetManager::loadTetBinAsset(string assertName, EigenVector3 translat
     if (readed == size) {
         result = new TetAsset();
 
+        uint64_t hash = hashBytes(dataStart, readed, HASH_INITIAL_VALUE);
+        hash = hashBytes(&scale, sizeof(scale), hash);
+        hash = hashBytes(rotation.coeffs().data(), 4 * sizeof(float), hash);
+        result->shapeHash = hashBytes(&ordering, sizeof(ordering), hash);
+
         EigenMatrix3 rotationMatrix = rotation.matrix();
 
         result->vertices.resize(vertexCount);
@@ -224,12 +271,46 @@ TetAsset* AssetManager::loadTetBinAsset(string assertName, EigenVector3 translat
                 result->tets[i][j] = tets[i].indices[j];
         }
 
+        vector<int> newIndex(vertexCount);
+        for (int i = 0; i < vertexCount; i++)
+            newIndex[i] = i;
+
+        //renumber the vertices and sort the tets, so the solver gathers from nearby memory
+        if (ordering != KeepOrdering) {
+            double distanceBefore = MeshReordering::computeGatherDistance(result->tets);
+
+            MeshReordering::computeVertexOrder(result->vertices, result->tets, ordering, newIndex);
+
+            vector<EigenVector3> reorderedVertices(vertexCount);
+            for (int i = 0; i < vertexCount; i++)
+                reorderedVertices[newIndex[i]] = result->vertices[i];
+            result->vertices.swap(reorderedVertices);
+
+            for (int i = 0; i < tetCount; i++)
+                for (int j = 0; j < 4; j++)
+                    result->tets[i][j] = newIndex[result->tets[i][j]];
+
+            vector<int> tetOrder;
+            MeshReordering::computeTetOrder(result->tets, tetOrder);
+
+            vector<vector<int>> reorderedTets(tetCount);
+            for (int i = 0; i < tetCount; i++)
+                reorderedTets[i].swap(result->tets[tetOrder[i]]);
+            result->tets.swap(reorderedTets);
+
+            double distanceAfter = MeshReordering::computeGatherDistance(result->tets);
+
+            print_log(ANDROID_LOG_INFO, ASSET_MANAGER_TAG, "%s: %s ordering, gather distance %.1f -> %.1f (%.0f%% saved)",
+                      assertName.c_str(), MeshReordering::getName(ordering), distanceBefore, distanceAfter,
+                      distanceBefore > 0.0 ? 100.0 * (1.0 - distanceAfter / distanceBefore) : 0.0);
+        }
+
         result->faces.resize(faceCount);
 
         for (int i = 0; i < faceCount; i++)
             for (int j = 0; j < 3; j++) {
 
-                EigenVector3 *vertex = &result->verticesToRender[faces[i].index[j]];
+                EigenVector3 *vertex = &result->verticesToRender[newIndex[faces[i].index[j]]];
 
                 TetAsset::EdgeVertex* edgeVertex = nullptr;
 
@@ -253,7 +334,7 @@ TetAsset* AssetManager::loadTetBinAsset(string assertName, EigenVector3 translat
         for (int i = 0; i < faceCount; i++)
             for (int j = 0; j < 3; j++) {
 
-                EigenVector3* vertex = &result->verticesToRender[faces[i].index[j]];
+                EigenVector3* vertex = &result->verticesToRender[newIndex[faces[i].index[j]]];
 
                 TetAsset::EdgeVertex* edgeVertex = nullptr;
                 for (int k = 0; k < result->edgeVertices.size(); k++) {
@@ -267,8 +348,8 @@ TetAsset* AssetManager::loadTetBinAsset(string assertName, EigenVector3 translat
                 TetAsset::Face* face = &result->faces[i];
 
                 face->vertex[j] = edgeVertex;
-                face->texCoord[j] = vec2(texCoords[faces[i].texIndex[j]].u,
-                                                    texCoords[faces[i].texIndex[j]].v);
+                face->texCoord[j] = EigenVector2(texCoords[faces[i].texIndex[j]].u,
+                                                 texCoords[faces[i].texIndex[j]].v);
 
                 edgeVertex->connectedFaces.push_back(face);
             }
@@ -277,13 +358,14 @@ TetAsset* AssetManager::loadTetBinAsset(string assertName, EigenVector3 translat
         result->vertexDataBuffer = new AssetVertex[result->bufferVertexCount];
     }
 
-    AAsset_close(asset);
-
     return result;
 }
 
 bool AssetManager::loadExternalBinaryFile(string fileName, void* dest, unsigned int size) {
 
+    if (this->externalFilesDir.empty())
+        return false;
+
     string fullFileName = this->externalFilesDir + "/" + fileName;
 
     bool result = false;
@@ -304,6 +386,9 @@ bool AssetManager::loadExternalBinaryFile(string fileName, void* dest, unsigned
 
 void AssetManager::saveExternalBinaryFile(string fileName, void* src, unsigned int size) {
 
+    if (this->externalFilesDir.empty())
+        return;
+
     string fullFileName = this->externalFilesDir + "/" + fileName;
 
     bool result = false;
@@ -335,16 +420,22 @@ void GPUAsset::syncWithGPU() {
     }
 }
 
+bool GPUAsset::isSyncedWithGPU() const {
+    return this->syncedWithGPU;
+}
+
 void GPUAsset::invalidate(bool fully) {
 
     syncedWithGPU = false;
 
+#ifdef __ANDROID__
     if (fully) {
         if (bufferID != 0) {
             glDeleteBuffers(1, &bufferID);
             bufferID = 0;
         }
     }
+#endif
 }
 
 void GPUAsset::transferToGPU() {
@@ -355,6 +446,7 @@ void GPUAsset::copyToGPU(GLenum usage) {
 
     // print_log(ANDROID_LOG_INFO, ASSET_MANAGER_TAG, "GPU Asset copied to GPU");
 
+#ifdef __ANDROID__
     if (bufferID == 0)
         glGenBuffers(1, &bufferID);
 
@@ -362,6 +454,7 @@ void GPUAsset::copyToGPU(GLenum usage) {
 
     glBindBuffer(GL_ARRAY_BUFFER, bufferID);
     glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)size, vertexDataBuffer, usage);
+#endif
 }
 
 // TetAsset
@@ -424,6 +517,10 @@ unsigned int TetAsset::getTetCount() {
     return tets.size();
 }
 
+uint64_t TetAsset::getShapeHash() const {
+    return this->shapeHash;
+}
+
 EigenVector3 TetAsset::getPosition() {
 
     EigenVector3 position = EigenVector3(0, 0, 0);
@@ -472,8 +569,8 @@ void TetAsset::transferToGPU() {
         vertexDataBuffer[vertexIndex].NY = faces[faceIndex].vertex[0]->normal.y();
         vertexDataBuffer[vertexIndex].NZ = faces[faceIndex].vertex[0]->normal.z();
 
-        vertexDataBuffer[vertexIndex].U = faces[faceIndex].texCoord[0].x;
-        vertexDataBuffer[vertexIndex].V = faces[faceIndex].texCoord[0].y;
+        vertexDataBuffer[vertexIndex].U = faces[faceIndex].texCoord[0].x();
+        vertexDataBuffer[vertexIndex].V = faces[faceIndex].texCoord[0].y();
 
         vertexIndex++;
 
@@ -481,8 +578,8 @@ void TetAsset::transferToGPU() {
         vertexDataBuffer[vertexIndex].NY = faces[faceIndex].vertex[1]->normal.y();
         vertexDataBuffer[vertexIndex].NZ = faces[faceIndex].vertex[1]->normal.z();
 
-        vertexDataBuffer[vertexIndex].U = faces[faceIndex].texCoord[1].x;
-        vertexDataBuffer[vertexIndex].V = faces[faceIndex].texCoord[1].y;
+        vertexDataBuffer[vertexIndex].U = faces[faceIndex].texCoord[1].x();
+        vertexDataBuffer[vertexIndex].V = faces[faceIndex].texCoord[1].y();
 
         vertexIndex++;
 
@@ -490,8 +587,8 @@ void TetAsset::transferToGPU() {
         vertexDataBuffer[vertexIndex].NY = faces[faceIndex].vertex[2]->normal.y();
         vertexDataBuffer[vertexIndex].NZ = faces[faceIndex].vertex[2]->normal.z();
 
-        vertexDataBuffer[vertexIndex].U = faces[faceIndex].texCoord[2].x;
-        vertexDataBuffer[vertexIndex].V = faces[faceIndex].texCoord[2].y;
+        vertexDataBuffer[vertexIndex].U = faces[faceIndex].texCoord[2].x();
+        vertexDataBuffer[vertexIndex].V = faces[faceIndex].texCoord[2].y();
 
         vertexIndex++;
     }
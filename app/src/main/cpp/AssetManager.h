@@ -1,22 +1,27 @@
 #ifndef FEMFORANDROID_ASSET_MANAGER_H
 #define FEMFORANDROID_ASSET_MANAGER_H
 
+#ifdef __ANDROID__
 #include <android/asset_manager.h>
 #include <android/asset_manager_jni.h>
 
 #include <GLES2/gl2.h>
-
-#include <glm/glm.hpp>
-#include <glm/gtc/quaternion.hpp>
+#else
+//headless builds have no GPU, the assets only keep their vertices
+typedef unsigned int GLuint;
+typedef unsigned int GLenum;
+#define GL_STATIC_DRAW 0x88E4
+#define GL_DYNAMIC_DRAW 0x88E8
+#endif
 
 #include <string>
 
 #include <vector>
 
 #include "EigenTypes.h"
+#include "MeshReordering.h"
 
 using namespace std;
-using namespace glm;
 
 struct AssetVertex {
     float X, Y, Z, NX, NY, NZ, U, V;
@@ -40,6 +45,7 @@ public:
 
     void syncWithGPU();
     void invalidate(bool fully = false);
+    bool isSyncedWithGPU() const;
 };
 
 class MeshAsset : public GPUAsset {
@@ -54,6 +60,8 @@ private:
 
     vector<vector<int>> tets;
 
+    uint64_t shapeHash;
+
     struct Face;
 
     struct EdgeVertex {
@@ -68,7 +76,7 @@ private:
         EdgeVertex* vertex[3];
         EigenVector3 normal;
         float area;
-        vec2 texCoord[3];
+        EigenVector2 texCoord[3];
     };
 
     vector<Face> faces;
@@ -85,6 +93,10 @@ public:
     vector<vector<int>>& getTets();
     unsigned int getTetCount();
 
+    //hash of the tetbin file and the scale, rotation and ordering it was loaded with.
+    //the translation is left out, it doesn't change the shape
+    uint64_t getShapeHash() const;
+
     EigenVector3 getPosition();
 };
 
@@ -103,11 +115,23 @@ private:
 
     int initialized;
 
+#ifdef __ANDROID__
     AAssetManager* nativeManager;
+#else
+    string assetsDir;
+#endif
 
+    //an empty directory disables the external files
     string externalFilesDir;
+
+    //the whole asset, from the APK on Android and from the assets directory otherwise
+    bool loadAsset(const string& assetName, vector<unsigned char>& data);
 public:
+#ifdef __ANDROID__
     void initialize(AAssetManager* nativeManager, string externalFilesDir);
+#else
+    void initialize(string assetsDir, string externalFilesDir);
+#endif
     void finalize();
 
     string loadTextAsset(string assertName);
@@ -116,7 +140,7 @@ public:
     MeshAsset* loadMeshBinAsset(string assertName, EigenVector3 translation, float scale,
             EigenQuaternion rotation);
     TetAsset* loadTetBinAsset(string assertName, EigenVector3 translation, float scale,
-            EigenQuaternion rotation);
+            EigenQuaternion rotation, MeshOrdering ordering = KeepOrdering);
 
     bool loadExternalBinaryFile(string fileName, void* dest, unsigned int size);
     void saveExternalBinaryFile(string fileName, void* src, unsigned int size);
@@ -0,0 +1,179 @@
+#include "ConstraintColoring.h"
+
+#include <algorithm>
+
+ConstraintColoring::ConstraintColoring(const vector<vector<int>>& tets, int vertexCount) : tets(tets) {
+
+    int tetCount = (int) tets.size();
+
+    vertexTetOffsets.assign(vertexCount + 1, 0);
+    for (int t = 0; t < tetCount; t++)
+        for (int j = 0; j < 4; j++)
+            vertexTetOffsets[tets[t][j] + 1]++;
+    for (int v = 0; v < vertexCount; v++)
+        vertexTetOffsets[v + 1] += vertexTetOffsets[v];
+
+    vertexTets.resize(vertexTetOffsets[vertexCount]);
+    vector<int> fill(vertexTetOffsets.begin(), vertexTetOffsets.end() - 1);
+    for (int t = 0; t < tetCount; t++)
+        for (int j = 0; j < 4; j++)
+            vertexTets[fill[tets[t][j]]++] = t;
+
+    colors.assign(tetCount, -1);
+}
+
+bool ConstraintColoring::canUseColor(int c, int color) const {
+
+    for (int j = 0; j < 4; j++) {
+        int v = tets[c][j];
+        for (int i = vertexTetOffsets[v]; i < vertexTetOffsets[v + 1]; i++)
+            if (vertexTets[i] != c && colors[vertexTets[i]] == color)
+                return false;
+    }
+
+    return true;
+}
+
+void ConstraintColoring::moveToColor(int c, int color) {
+
+    if (colors[c] >= 0)
+        sizes[colors[c]]--;
+
+    colors[c] = color;
+    sizes[color]++;
+}
+
+void ConstraintColoring::colorGreedy() {
+
+    int tetCount = (int) tets.size();
+
+    //number of constraints sharing a vertex, counted with multiplicity
+    vector<int> degree(tetCount, 0);
+    for (int t = 0; t < tetCount; t++)
+        for (int j = 0; j < 4; j++) {
+            int v = tets[t][j];
+            degree[t] += vertexTetOffsets[v + 1] - vertexTetOffsets[v] - 1;
+        }
+
+    vector<int> order(tetCount);
+    for (int t = 0; t < tetCount; t++)
+        order[t] = t;
+
+    std::stable_sort(order.begin(), order.end(), [&degree](int a, int b) { return degree[a] > degree[b]; });
+
+    //forbidden[k] == c if color k is taken by a neighbour of constraint c
+    vector<int> forbidden;
+
+    for (int n = 0; n < tetCount; n++) {
+        int c = order[n];
+
+        for (int j = 0; j < 4; j++) {
+            int v = tets[c][j];
+            for (int i = vertexTetOffsets[v]; i < vertexTetOffsets[v + 1]; i++) {
+                int color = colors[vertexTets[i]];
+                if (color >= 0)
+                    forbidden[color] = c;
+            }
+        }
+
+        int color = 0;
+        while (color < (int) forbidden.size() && forbidden[color] == c)
+            color++;
+
+        if (color == (int) forbidden.size()) {
+            forbidden.push_back(-1);
+            sizes.push_back(0);
+        }
+
+        moveToColor(c, color);
+    }
+}
+
+void ConstraintColoring::balanceSizes() {
+
+    int tetCount = (int) tets.size();
+    int colorCount = (int) sizes.size();
+
+    if (colorCount < 2)
+        return;
+
+    int target = (tetCount + colorCount - 1) / colorCount;
+
+    //colors in order of increasing size are the destinations. the array is sorted once, every move only
+    //changes the order around the destination. the sources stay above the target, behind all destinations
+    vector<int> bySize(colorCount);
+    for (int k = 0; k < colorCount; k++)
+        bySize[k] = k;
+
+    std::sort(bySize.begin(), bySize.end(), [this](int a, int b) { return sizes[a] < sizes[b]; });
+
+    for (int c = 0; c < tetCount; c++) {
+        int from = colors[c];
+        if (sizes[from] <= target)
+            continue;
+
+        for (int k = 0; k < colorCount && sizes[bySize[k]] < target; k++)
+            if (canUseColor(c, bySize[k])) {
+                //the destination grows by one, swapping it with the last color of its old size keeps the order
+                int size = sizes[bySize[k]];
+                auto last = std::upper_bound(bySize.begin() + k, bySize.end(), size,
+                        [this](int s, int color) { return s < sizes[color]; }) - 1;
+
+                moveToColor(c, bySize[k]);
+                std::swap(bySize[k], *last);
+                break;
+            }
+    }
+}
+
+void ConstraintColoring::roundSizes(int laneWidth) {
+
+    int tetCount = (int) tets.size();
+    int colorCount = (int) sizes.size();
+
+    //members of every color, kept up to date only for the colors not processed yet
+    vector<vector<int>> members(colorCount);
+    for (int c = 0; c < tetCount; c++)
+        members[colors[c]].push_back(c);
+
+    //a color that can't be filled from this many candidates stays partial
+    const int maxCandidates = ROUND_CANDIDATES_PER_LANE * laneWidth;
+
+    for (int k = 0; k + 1 < colorCount; k++) {
+        int tested = 0;
+
+        //pull constraints of the later colors, starting with the smallest ones at the end
+        for (int from = colorCount - 1; from > k && sizes[k] % laneWidth != 0 && tested < maxCandidates; from--) {
+            vector<int>& candidates = members[from];
+
+            for (size_t i = 0; i < candidates.size() && sizes[k] % laneWidth != 0 && tested < maxCandidates; tested++)
+                if (canUseColor(candidates[i], k)) {
+                    moveToColor(candidates[i], k);
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                } else
+                    i++;
+        }
+    }
+}
+
+void ConstraintColoring::compute(const vector<vector<int>>& tets, int vertexCount, int laneWidth,
+        vector<vector<int>>& coloring) {
+
+    ConstraintColoring engine(tets, vertexCount);
+
+    engine.colorGreedy();
+    engine.balanceSizes();
+    engine.roundSizes(laneWidth);
+
+    coloring.assign(engine.sizes.size(), vector<int>());
+    for (size_t k = 0; k < coloring.size(); k++)
+        coloring[k].reserve(engine.sizes[k]);
+
+    for (size_t c = 0; c < tets.size(); c++)
+        coloring[engine.colors[c]].push_back((int) c);
+
+    //moving constraints may empty a color
+    coloring.erase(std::remove_if(coloring.begin(), coloring.end(),
+            [](const vector<int>& color) { return color.empty(); }), coloring.end());
+}
@@ -0,0 +1,42 @@
+#ifndef FEMFORANDROID_CONSTRAINT_COLORING_H
+#define FEMFORANDROID_CONSTRAINT_COLORING_H
+
+#include <vector>
+
+using namespace std;
+
+// colors tet constraints so that the constraints of one color share no vertex.
+// constraints are colored greedily in order of decreasing degree, the neighbours are found through
+// the tets around every vertex in CSR format, so the work is linear in the size of the neighbourhoods.
+// afterwards constraints are moved out of the largest colors into the smallest ones, and every color
+// is filled up to a multiple of the lane width with constraints of the following colors,
+// so only the last colors end with partially filled SIMD batches. filling a color tests a bounded
+// number of candidates, which keeps the whole coloring close to linear in the number of constraints
+class ConstraintColoring {
+private:
+    static const int ROUND_CANDIDATES_PER_LANE = 64;
+
+    const vector<vector<int>>& tets;
+
+    vector<int> vertexTetOffsets;
+    vector<int> vertexTets;
+
+    vector<int> colors;
+    vector<int> sizes;
+
+    ConstraintColoring(const vector<vector<int>>& tets, int vertexCount);
+
+    // true if no other constraint sharing a vertex with c has the given color
+    bool canUseColor(int c, int color) const;
+    void moveToColor(int c, int color);
+
+    void colorGreedy();
+    void balanceSizes();
+    void roundSizes(int laneWidth);
+public:
+    // coloring[i] lists the constraints of color i in ascending order
+    static void compute(const vector<vector<int>>& tets, int vertexCount, int laneWidth,
+            vector<vector<int>>& coloring);
+};
+
+#endif //FEMFORANDROID_CONSTRAINT_COLORING_H
@@ -6,6 +6,7 @@
 #define _USE_MATH_DEFINES
 #include <cmath> 
 
+using EigenVector2 = Eigen::Matrix<float, 2, 1>;
 using EigenVector3 = Eigen::Matrix<float, 3, 1>;
 using EigenMatrix3 = Eigen::Matrix<float, 3, 3>;
 using EigenMatrix4 = Eigen::Matrix<float, 4, 4>;
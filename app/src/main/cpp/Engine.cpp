@@ -67,6 +67,10 @@ void Engine::setOutputWindow(ANativeWindow* window) {
     pushEvent(SetOutputWindow, (void*)window);
 }
 
+void Engine::setMaterial(const Material& material) {
+    pushEvent(SetMaterial, (void*)new Material(material));
+}
+
 // thread
 
 void* Engine::thread_entrypoint(void* opaque) {
@@ -123,12 +127,13 @@ void Engine::processEvents() {
 
 void Engine::processEvent(EngineEvent& event) {
 
-    char* eventNames[5] = {
+    char* eventNames[6] = {
         "Initialize",
         "Finalize",
         "Start",
         "Stop",
-        "SetOutputWindow"
+        "SetOutputWindow",
+        "SetMaterial"
     };
     print_log(ANDROID_LOG_INFO, ENGINE_TAG, "Event: %s", eventNames[event.message]);
 
@@ -140,6 +145,7 @@ void Engine::processEvent(EngineEvent& event) {
 
             AssetManager::getInstance().initialize(initStruct->nativeAssetManager, initStruct->externalFilesDir);
             Render::getInstance().initialize();
+            // only loads the assets, the solver is prepared in the background while the rest pose is drawn
             Physics::getInstance().initialize();
             InputManager::getInstance().initialize();
 
@@ -165,6 +171,13 @@ void Engine::processEvent(EngineEvent& event) {
         case SetOutputWindow:
             Render::getInstance().setOutputWindow((ANativeWindow*)event.param);
             break;
+        case SetMaterial: {
+            Material* material = (Material*)event.param;
+            // returns right away, the refactorization runs in the background
+            Physics::getInstance().setMaterial(*material);
+            delete material;
+            break;
+        }
         default:
             my_assert(false);
             break;
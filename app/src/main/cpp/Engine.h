@@ -8,6 +8,8 @@
 
 #include "readerwriterqueue.h"
 
+#include "Material.h"
+
 #include <string>
 
 using namespace moodycamel;
@@ -31,7 +33,8 @@ private:
         Finalize,
         Start,
         Stop,
-        SetOutputWindow
+        SetOutputWindow,
+        SetMaterial
     };
 
     struct EngineEvent {
@@ -67,6 +70,8 @@ public:
     void stop();
 
     void setOutputWindow(ANativeWindow* window);
+
+    void setMaterial(const Material& material);
 };
 
 #endif //FEMFORANDROIDENGINE_H
@@ -0,0 +1,103 @@
+#include "FactorCache.h"
+
+#include <cstring>
+
+#include "AssetManager.h"
+#include "exceptionUtils.h"
+
+extern "C" {
+#include "generalUtils.h"
+}
+
+using namespace Eigen;
+
+FactorCache::FactorCache(const string& fileName) : fileName(fileName), readOffset(0) {
+
+}
+
+uint64_t FactorCache::computeKey(uint64_t shapesHash, const Material& material, double dt, int timeStepLevels) {
+
+    uint64_t hash = hashBytes(&shapesHash, sizeof(shapesHash), HASH_INITIAL_VALUE);
+    hash = hashBytes(&material.density, sizeof(material.density), hash);
+    hash = hashBytes(&material.youngsModulus, sizeof(material.youngsModulus), hash);
+    hash = hashBytes(&material.poissonRatio, sizeof(material.poissonRatio), hash);
+    hash = hashBytes(&dt, sizeof(dt), hash);
+    return hashBytes(&timeStepLevels, sizeof(timeStepLevels), hash);
+}
+
+bool FactorCache::load(uint64_t key) {
+
+    data.clear();
+    readOffset = 0;
+
+    Header header;
+    if (!AssetManager::getInstance().loadExternalBinaryFile(fileName, &header, sizeof(header)))
+        return false;
+
+    if (header.magic != MAGIC || header.version != VERSION || header.key != key)
+        return false;
+
+    vector<char> file(sizeof(header) + header.size);
+    if (!AssetManager::getInstance().loadExternalBinaryFile(fileName, file.data(), (unsigned int) file.size()))
+        return false;
+
+    data.assign(file.begin() + sizeof(header), file.end());
+    return true;
+}
+
+void FactorCache::save(uint64_t key) {
+
+    Header header = { MAGIC, VERSION, key, data.size() };
+
+    vector<char> file(sizeof(header) + data.size());
+    memcpy(file.data(), &header, sizeof(header));
+    if (!data.empty())
+        memcpy(file.data() + sizeof(header), data.data(), data.size());
+
+    AssetManager::getInstance().saveExternalBinaryFile(fileName, file.data(), (unsigned int) file.size());
+}
+
+void FactorCache::putBytes(const void* src, size_t size) {
+    data.insert(data.end(), (const char*) src, (const char*) src + size);
+}
+
+bool FactorCache::getBytes(void* dest, size_t size) {
+
+    if (size > data.size() - readOffset)
+        return false;
+
+    if (size > 0)
+        memcpy(dest, data.data() + readOffset, size);
+    readOffset += size;
+    return true;
+}
+
+//compressed column storage: column offsets, row indices and values
+void FactorCache::put(const SparseMatrix<float, ColMajor>& matrix) {
+
+    my_assert(matrix.isCompressed());
+
+    int64_t size[2] = { matrix.rows(), matrix.cols() };
+    putBytes(size, sizeof(size));
+
+    put(vector<int>(matrix.outerIndexPtr(), matrix.outerIndexPtr() + matrix.outerSize() + 1));
+    put(vector<int>(matrix.innerIndexPtr(), matrix.innerIndexPtr() + matrix.nonZeros()));
+    put(vector<float>(matrix.valuePtr(), matrix.valuePtr() + matrix.nonZeros()));
+}
+
+bool FactorCache::get(SparseMatrix<float, ColMajor>& matrix) {
+
+    int64_t size[2];
+    vector<int> outer, inner;
+    vector<float> values;
+
+    if (!getBytes(size, sizeof(size)) || !get(outer) || !get(inner) || !get(values))
+        return false;
+
+    if (outer.size() != size[1] + 1 || inner.size() != values.size() || outer.back() != (int) values.size())
+        return false;
+
+    matrix = Map<const SparseMatrix<float, ColMajor>>(size[0], size[1], (int) values.size(),
+            outer.data(), inner.data(), values.data());
+    return true;
+}
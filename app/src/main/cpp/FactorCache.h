@@ -0,0 +1,70 @@
+#ifndef FEMFORANDROID_FACTOR_CACHE_H
+#define FEMFORANDROID_FACTOR_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Eigen/Sparse"
+
+#include "Material.h"
+
+using namespace std;
+
+// one file in the external files directory that keeps the results of the expensive part of the initialization,
+// the Cholesky factorization and the constants it is built from, for the next start.
+// the file is only used if its key matches, see computeKey. the contents are written and read back
+// in the same order with put and get, every get fails once the data runs out
+class FactorCache {
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t size;	//bytes following the header
+    };
+
+    static const uint32_t MAGIC = 0x46414354;	//"FACT"
+    // bump whenever the contents change
+    static const uint32_t VERSION = 4;
+
+    string fileName;
+
+    vector<char> data;
+    size_t readOffset;
+
+    void putBytes(const void* src, size_t size);
+    bool getBytes(void* dest, size_t size);
+public:
+    explicit FactorCache(const string& fileName);
+
+    // key of the factorizations of the shapes of a scene (combined TetAsset::getShapeHash) with a material
+    // for the time steps dt, 2 dt, ... of timeStepLevels levels
+    static uint64_t computeKey(uint64_t shapesHash, const Material& material, double dt, int timeStepLevels);
+
+    // reads the file if it was written with the same key, the contents are then available through get
+    bool load(uint64_t key);
+    // writes everything put so far
+    void save(uint64_t key);
+
+    template <typename T>
+    void put(const vector<T>& values) {
+        uint64_t count = values.size();
+        putBytes(&count, sizeof(count));
+        putBytes(values.data(), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    bool get(vector<T>& values) {
+        uint64_t count;
+        if (!getBytes(&count, sizeof(count)) || count * sizeof(T) > data.size() - readOffset)
+            return false;
+        values.resize(count);
+        return getBytes(values.data(), count * sizeof(T));
+    }
+
+    void put(const Eigen::SparseMatrix<float, Eigen::ColMajor>& matrix);
+    bool get(Eigen::SparseMatrix<float, Eigen::ColMajor>& matrix);
+};
+
+#endif //FEMFORANDROID_FACTOR_CACHE_H
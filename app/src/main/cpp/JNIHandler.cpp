@@ -87,4 +87,21 @@ extern "C" JNIEXPORT void JNICALL Java_com_example_femforandroid_JNIHandler_setO
     } catch(...) {
         swallow_cpp_exception_and_throw_java(env);
     }
+}
+
+extern "C" JNIEXPORT void JNICALL Java_com_example_femforandroid_JNIHandler_setMaterial(
+        JNIEnv *env, jclass /*this*/, jfloat density, jfloat youngsModulus, jfloat poissonRatio) {
+    try {
+        COFFEE_TRY() {
+            Material material;
+            material.density = density;
+            material.youngsModulus = youngsModulus;
+            material.poissonRatio = poissonRatio;
+            Engine::getInstance().setMaterial(material);
+        } COFFEE_CATCH() {
+            coffeecatch_throw_exception(env);
+        } COFFEE_END();
+    } catch(...) {
+        swallow_cpp_exception_and_throw_java(env);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "KernelDispatch.h"
+
+#if defined(__arm__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+bool KernelDispatch::isSupported(KernelInstructionSet instructionSet) {
+
+    switch (instructionSet) {
+        case ScalarKernels:
+            return true;
+#if defined(__x86_64__) || defined(__i386__)
+        case SSE4Kernels:
+            return __builtin_cpu_supports("sse4.1");
+        case AVX2Kernels:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case AVX512Kernels:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma");
+#elif defined(__aarch64__)
+        case NEONKernels:
+            return true;    //part of ARMv8-A
+#elif defined(__arm__)
+        case NEONKernels:
+            return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+        default:
+            return false;
+    }
+}
+
+void KernelDispatch::getAvailable(vector<SolverKernelTable>& available) {
+
+    available.clear();
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    if (isSupported(AVX512Kernels))
+        available.push_back(getAVX512Kernels());
+    if (isSupported(AVX2Kernels))
+        available.push_back(getAVX2Kernels());
+    if (isSupported(SSE4Kernels))
+        available.push_back(getSSE4Kernels());
+#elif defined(__arm__) || defined(__aarch64__)
+    if (isSupported(NEONKernels))
+        available.push_back(getNEONKernels());
+#endif
+
+    available.push_back(getScalarKernels());
+}
+
+SolverKernelTable KernelDispatch::select(KernelInstructionSet instructionSet, int laneWidth) {
+
+    vector<SolverKernelTable> available;
+    getAvailable(available);
+
+    for (size_t i = 0; i < available.size(); i++)
+        if (available[i].instructionSet == instructionSet)
+            return available[i];
+
+    for (size_t i = 0; i < available.size(); i++)
+        if (available[i].laneWidth == laneWidth)
+            return available[i];
+
+    return available[0];
+}
@@ -0,0 +1,33 @@
+#ifndef FEMFORANDROID_KERNEL_DISPATCH_H
+#define FEMFORANDROID_KERNEL_DISPATCH_H
+
+#include <vector>
+
+#include "SolverBatches.h"
+
+using namespace std;
+
+// picks the solver kernels at runtime. every instruction set has its own translation unit (SolverKernels_*.cpp)
+// compiled with its flags, and only the kernels the CPU supports are handed out, so one library
+// covers every CPU of its ABI. which units exist depends on the ABI, see CMakeLists.txt
+class KernelDispatch {
+public:
+    // kernels built into the library that the CPU supports, the widest first
+    static void getAvailable(vector<SolverKernelTable>& available);
+
+    // the kernels of instructionSet if the CPU supports them, otherwise the widest available ones
+    // with laneWidth lanes, otherwise the widest available ones. AutoKernels and 0 leave the choice open
+    static SolverKernelTable select(KernelInstructionSet instructionSet, int laneWidth);
+
+private:
+    static bool isSupported(KernelInstructionSet instructionSet);
+
+    // defined in the translation unit of each instruction set
+    static SolverKernelTable getScalarKernels();
+    static SolverKernelTable getSSE4Kernels();
+    static SolverKernelTable getAVX2Kernels();
+    static SolverKernelTable getAVX512Kernels();
+    static SolverKernelTable getNEONKernels();
+};
+
+#endif //FEMFORANDROID_KERNEL_DISPATCH_H
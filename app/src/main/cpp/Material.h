@@ -0,0 +1,20 @@
+#ifndef FEMFORANDROID_MATERIAL_H
+#define FEMFORANDROID_MATERIAL_H
+
+// material of the simulated model, the defaults are bread.
+// copper would be a density of 2810, E = 10 * 1.0e6 and nu = 0.32
+struct Material {
+    float density = 190.0f;
+    float youngsModulus = 0.3f * 1.0e6f;
+    float poissonRatio = 0.78f;
+
+    float getMu() const {
+        return youngsModulus / (2.0f * (1.0f + poissonRatio));
+    }
+
+    float getLambda() const {
+        return (youngsModulus * poissonRatio) / ((1.0f + poissonRatio) * (1.0f - 2.0f * poissonRatio));
+    }
+};
+
+#endif //FEMFORANDROID_MATERIAL_H
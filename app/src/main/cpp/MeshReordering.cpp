@@ -0,0 +1,201 @@
+#include "MeshReordering.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#include "exceptionUtils.h"
+
+// spreads the lower 10 bits of v so that there are two zero bits between each of them
+static uint32_t spreadBits(uint32_t v) {
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v <<  8)) & 0x0300F00F;
+    v = (v | (v <<  4)) & 0x030C30C3;
+    v = (v | (v <<  2)) & 0x09249249;
+    return v;
+}
+
+void MeshReordering::computeMortonOrder(const vector<EigenVector3>& vertices, vector<int>& order) {
+
+    EigenVector3 low = EigenVector3(FLT_MAX, FLT_MAX, FLT_MAX);
+    EigenVector3 high = -low;
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        low = low.cwiseMin(vertices[i]);
+        high = high.cwiseMax(vertices[i]);
+    }
+
+    EigenVector3 extent = (high - low).cwiseMax(EigenVector3(1e-6f, 1e-6f, 1e-6f));
+
+    vector<uint32_t> codes(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        EigenVector3 cell = (vertices[i] - low).cwiseQuotient(extent) * 1023.0f;
+        codes[i] = spreadBits((uint32_t) cell.x()) |
+                   (spreadBits((uint32_t) cell.y()) << 1) |
+                   (spreadBits((uint32_t) cell.z()) << 2);
+    }
+
+    order.resize(vertices.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = (int) i;
+
+    std::stable_sort(order.begin(), order.end(), [&codes](int a, int b) { return codes[a] < codes[b]; });
+}
+
+void MeshReordering::computeRCMOrder(const vector<vector<int>>& tets, int vertexCount, vector<int>& order) {
+
+    vector<vector<int>> adjacency(vertexCount);
+    for (size_t t = 0; t < tets.size(); t++)
+        for (int j = 0; j < 4; j++)
+            for (int k = 0; k < 4; k++)
+                if (j != k)
+                    adjacency[tets[t][j]].push_back(tets[t][k]);
+
+    for (int i = 0; i < vertexCount; i++) {
+        vector<int>& neighbours = adjacency[i];
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    }
+
+    auto byDegree = [&adjacency](int a, int b) {
+        return adjacency[a].size() < adjacency[b].size() || (adjacency[a].size() == adjacency[b].size() && a < b);
+    };
+
+    for (int i = 0; i < vertexCount; i++)
+        std::sort(adjacency[i].begin(), adjacency[i].end(), byDegree);
+
+    vector<int> level(vertexCount, -1);
+    vector<bool> visited(vertexCount, false);
+
+    //breadth first search over the unvisited vertices, returns the vertices in visiting order
+    auto search = [&](int start, vector<int>& queue) {
+        queue.clear();
+        queue.push_back(start);
+        level[start] = 0;
+        for (size_t head = 0; head < queue.size(); head++) {
+            int v = queue[head];
+            for (size_t n = 0; n < adjacency[v].size(); n++) {
+                int u = adjacency[v][n];
+                if (!visited[u] && level[u] < 0) {
+                    level[u] = level[v] + 1;
+                    queue.push_back(u);
+                }
+            }
+        }
+        for (size_t i = 0; i < queue.size(); i++)
+            level[queue[i]] = -1;
+    };
+
+    order.clear();
+    order.reserve(vertexCount);
+
+    vector<int> queue;
+
+    for (int seed = 0; seed < vertexCount; seed++) {
+        if (visited[seed])
+            continue;
+
+        //start from the vertex of smallest degree in this component
+        search(seed, queue);
+        int start = *std::min_element(queue.begin(), queue.end(), byDegree);
+
+        //move towards a pseudo-peripheral vertex, the last vertex reached from the other end
+        for (int it = 0; it < 4; it++) {
+            search(start, queue);
+            int candidate = queue.back();
+            if (candidate == start)
+                break;
+            start = candidate;
+        }
+
+        //Cuthill-McKee: breadth first with the neighbours visited in order of increasing degree
+        size_t head = order.size();
+        order.push_back(start);
+        visited[start] = true;
+        for (; head < order.size(); head++) {
+            int v = order[head];
+            for (size_t n = 0; n < adjacency[v].size(); n++) {
+                int u = adjacency[v][n];
+                if (!visited[u]) {
+                    visited[u] = true;
+                    order.push_back(u);
+                }
+            }
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+}
+
+void MeshReordering::computeVertexOrder(const vector<EigenVector3>& vertices, const vector<vector<int>>& tets,
+        MeshOrdering ordering, vector<int>& newIndex) {
+
+    vector<int> order;
+
+    switch (ordering) {
+        case MortonOrdering:
+            computeMortonOrder(vertices, order);
+            break;
+        case RCMOrdering:
+            computeRCMOrder(tets, (int) vertices.size(), order);
+            break;
+        default:
+            order.resize(vertices.size());
+            for (size_t i = 0; i < order.size(); i++)
+                order[i] = (int) i;
+            break;
+    }
+
+    my_assert(order.size() == vertices.size());
+
+    newIndex.resize(vertices.size());
+    for (size_t i = 0; i < order.size(); i++)
+        newIndex[order[i]] = (int) i;
+}
+
+void MeshReordering::computeTetOrder(const vector<vector<int>>& tets, vector<int>& order) {
+
+    vector<int> lowest(tets.size()), highest(tets.size());
+    for (size_t t = 0; t < tets.size(); t++) {
+        lowest[t] = *std::min_element(tets[t].begin(), tets[t].end());
+        highest[t] = *std::max_element(tets[t].begin(), tets[t].end());
+    }
+
+    order.resize(tets.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = (int) i;
+
+    std::stable_sort(order.begin(), order.end(), [&lowest, &highest](int a, int b) {
+        return lowest[a] < lowest[b] || (lowest[a] == lowest[b] && highest[a] < highest[b]);
+    });
+}
+
+double MeshReordering::computeGatherDistance(const vector<vector<int>>& tets) {
+
+    if (tets.empty())
+        return 0.0;
+
+    double distance = 0.0;
+    int previous = tets[0][0];
+
+    for (size_t t = 0; t < tets.size(); t++)
+        for (int j = 0; j < 4; j++) {
+            distance += std::abs(tets[t][j] - previous);
+            previous = tets[t][j];
+        }
+
+    return distance / (tets.size() * 4);
+}
+
+const char* MeshReordering::getName(MeshOrdering ordering) {
+
+    switch (ordering) {
+        case MortonOrdering:
+            return "Morton";
+        case RCMOrdering:
+            return "RCM";
+        default:
+            return "original";
+    }
+}
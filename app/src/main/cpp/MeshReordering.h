@@ -0,0 +1,39 @@
+#ifndef FEMFORANDROID_MESH_REORDERING_H
+#define FEMFORANDROID_MESH_REORDERING_H
+
+#include <vector>
+
+#include "EigenTypes.h"
+
+using namespace std;
+
+enum MeshOrdering {
+    //keep the order produced by tetgen
+    KeepOrdering,
+    //sort vertices along a Z-order (Morton) curve through the bounding box
+    MortonOrdering,
+    //reverse Cuthill-McKee over the vertex adjacency of the tets
+    RCMOrdering
+};
+
+// computes cache friendly orderings of tet meshes.
+// vertices are renumbered so that neighbours get close indices, then tets are sorted by their
+// smallest vertex index, so consecutive tets gather from nearby memory
+class MeshReordering {
+private:
+    static void computeMortonOrder(const vector<EigenVector3>& vertices, vector<int>& order);
+    static void computeRCMOrder(const vector<vector<int>>& tets, int vertexCount, vector<int>& order);
+public:
+    //newIndex[i] is the new index of vertex i
+    static void computeVertexOrder(const vector<EigenVector3>& vertices, const vector<vector<int>>& tets,
+            MeshOrdering ordering, vector<int>& newIndex);
+    //order[i] is the old index of the tet which goes to position i
+    static void computeTetOrder(const vector<vector<int>>& tets, vector<int>& order);
+
+    //average index distance between consecutive vertex gathers when the tets are traversed in order
+    static double computeGatherDistance(const vector<vector<int>>& tets);
+
+    static const char* getName(MeshOrdering ordering);
+};
+
+#endif //FEMFORANDROID_MESH_REORDERING_H
@@ -10,234 +10,163 @@
 
 #include "EigenTypes.h"
 
-// ----------------------------------------------------------------------------------------------
-//vector of 4 float values to represent 4 scalars
-class Scalarf4
-{
-public:
-	float32x4_t v;
-
-	Scalarf4() {}
-
-	Scalarf4(float f) {
-		v = vdupq_n_f32(f);
-	}
-
-	Scalarf4(float f0, float f1, float f2, float f3) {
-		float __attribute__((aligned(16))) data[4] = { f0, f1, f2, f3 };
-		v = vld1q_f32(data);
-	}
-
-	Scalarf4(float32x4_t const & x) {
-		v = x;
-	}
-
-	Scalarf4 & operator = (float32x4_t const & x) {
-		v = x;
-		return *this;
-	}
-
-	Scalarf4& load(float const * p) {
-		v = vld1q_f32(p);
-		return *this;
-	}
-	
-	void store(float * p) const {
-		vst1q_f32(p, v);
-	}
-};
-
-static inline Scalarf4 operator + (Scalarf4 const & a, Scalarf4 const & b) {
-	return vaddq_f32(a.v, b.v);
-}
-
-static inline Scalarf4 & operator += (Scalarf4 & a, Scalarf4 const & b) {
-	a.v = vaddq_f32(a.v, b.v);
-	return a;
-}
-
-static inline Scalarf4 operator - (Scalarf4 const & a, Scalarf4 const & b) {
-	return vsubq_f32(a.v, b.v);
-}
-
-static inline Scalarf4 & operator -= (Scalarf4 & a, Scalarf4 const & b) {
-	a.v = vsubq_f32(a.v, b.v);
-	return a;
-}
-
-static inline Scalarf4 operator * (Scalarf4 const & a, Scalarf4 const & b) {
-	return vmulq_f32(a.v, b.v);
-}
-
-static inline Scalarf4 & operator *= (Scalarf4 & a, Scalarf4 const & b) {
-	a.v = vmulq_f32(a.v, b.v);
-	return a;
-}
-
-static inline Scalarf4 operator / (Scalarf4 const & a, Scalarf4 const & b) {
-
-    float32x4_t recip = vrecpeq_f32(b.v);
+//the solver kernels are compiled once per instruction set (see KernelDispatch.h). each of these translation units
+//defines SIMD_NAMESPACE, so the SIMD types built with its compiler flags do not mix with the ones of the other units
+#ifdef SIMD_NAMESPACE
+#define SIMD_NAMESPACE_BEGIN namespace SIMD_NAMESPACE {
+#define SIMD_NAMESPACE_END }
+#define SIMD_SCOPE SIMD_NAMESPACE
+#else
+#define SIMD_NAMESPACE_BEGIN
+#define SIMD_NAMESPACE_END
+#define SIMD_SCOPE
+#endif
 
-    recip = vmulq_f32(recip, vrecpsq_f32(recip, b.v));
-    recip = vmulq_f32(recip, vrecpsq_f32(recip, b.v));
-
-    return vmulq_f32(a.v, recip);
-}
-
-static inline Scalarf4 operator == (Scalarf4 const & a, Scalarf4 const & b) {
-	return vceqq_f32(a.v, b.v);
-}
-
-static inline Scalarf4 operator != (Scalarf4 const & a, Scalarf4 const & b) {
-	return vmvnq_u32(vceqq_f32(a.v, b.v));
-}
-
-static inline Scalarf4 operator < (Scalarf4 const & a, Scalarf4 const & b) {
-	return vcltq_f32(a.v, b.v);
-}
-
-static inline Scalarf4 operator <= (Scalarf4 const & a, Scalarf4 const & b) {
-	return vcleq_f32(a.v, b.v);
-}
-
-static inline Scalarf4 operator > (Scalarf4 const & a, Scalarf4 const & b) {
-	return vcgtq_f32(a.v, b.v);
-}
-
-static inline Scalarf4 operator >= (Scalarf4 const & a, Scalarf4 const & b) {
-	return vcgeq_f32(a.v, b.v);
-}
-
-static inline Scalarf4 abs(Scalarf4 const & a) {
-	return vabsq_f32(a.v);
-}
-
-//does the same as for (int i = 0; i < 4; i++) result[i] = c[i] ? a[i] : b[i];
-//the elemets in c must be either 0 (false) or 0xFFFFFFFF (true)
-static inline Scalarf4 blend(Scalarf4 const & c, Scalarf4 const & a, Scalarf4 const & b) {
-	return vbslq_f32(reinterpret_cast<uint32x4_t>(c.v), a.v, b.v);
-}
+// ----------------------------------------------------------------------------------------------
+//Scalarf4 and its operations are implemented once per instruction set, chosen at compile time.
+//comparisons return masks with all bits of an element either set or cleared, blend selects by them.
+//SIMD_SCALAR forces the plain C++ version, it is also the fallback without NEON and SSE4.1
+#if defined(SIMD_SCALAR)
+#include "Scalarf4_Scalar.h"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include "Scalarf4_NEON.h"
+#elif defined(__SSE4_1__)
+#include "Scalarf4_SSE.h"
+#else
+#include "Scalarf4_Scalar.h"
+#endif
+
+//8 lanes on x86 with AVX2, 16 with AVX-512
+#if defined(__AVX2__) && !defined(SIMD_SCALAR)
+#include "Scalarf8_AVX.h"
+#endif
+#if defined(__AVX512F__) && !defined(SIMD_SCALAR)
+#include "Scalarf16_AVX512.h"
+#endif
+
+SIMD_NAMESPACE_BEGIN
 
 // ----------------------------------------------------------------------------------------------
-//3 dimensional vector of Scalar4f to represent 4 3d vectors
-class Vector3f4
+//3 dimensional vector of Scalar to represent Scalar::WIDTH 3d vectors
+template <class Scalar>
+class SIMDVector3
 {
 public:
 
-	Scalarf4 v[3];
+	Scalar v[3];
 
-	Vector3f4() { v[0] = 0.0; v[1] = 0.0; v[2] = 0.0; }
-	Vector3f4(Scalarf4 x, Scalarf4 y, Scalarf4 z) { v[0] = x; v[1] = y; v[2] = z; }
-	Vector3f4(Scalarf4 x) { v[0] = v[1] = v[2] = x; }
+	SIMDVector3() { v[0] = 0.0; v[1] = 0.0; v[2] = 0.0; }
+	SIMDVector3(Scalar x, Scalar y, Scalar z) { v[0] = x; v[1] = y; v[2] = z; }
+	SIMDVector3(Scalar x) { v[0] = v[1] = v[2] = x; }
 
-	inline Scalarf4& operator [] (int i) { return v[i]; }
-	inline Scalarf4 operator [] (int i) const { return v[i]; }
+	inline Scalar& operator [] (int i) { return v[i]; }
+	inline Scalar operator [] (int i) const { return v[i]; }
 
-	inline Scalarf4& x() { return v[0]; }
-	inline Scalarf4& y() { return v[1]; }
-	inline Scalarf4& z() { return v[2]; }
+	inline Scalar& x() { return v[0]; }
+	inline Scalar& y() { return v[1]; }
+	inline Scalar& z() { return v[2]; }
 
-	inline Scalarf4 x() const { return v[0]; }
-	inline Scalarf4 y() const { return v[1]; }
-	inline Scalarf4 z() const { return v[2]; }
+	inline Scalar x() const { return v[0]; }
+	inline Scalar y() const { return v[1]; }
+	inline Scalar z() const { return v[2]; }
 	
-	inline Scalarf4 dot(const Vector3f4& a) const {
-		return v[0] * a.v[0] + v[1] * a.v[1] + v[2] * a.v[2];
+	//the products are chained with multiplyAdd, fused on the instruction sets that have it
+	inline Scalar dot(const SIMDVector3& a) const {
+		return multiplyAdd(multiplyAdd(v[0] * a.v[0], v[1], a.v[1]), v[2], a.v[2]);
 	}
 
 	//dot product
-	inline Scalarf4 operator * (const Vector3f4& a) const {
-		return v[0] * a.v[0] + v[1] * a.v[1] + v[2] * a.v[2];
+	inline Scalar operator * (const SIMDVector3& a) const {
+		return dot(a);
 	}
 
-	inline void cross(const Vector3f4& a, const Vector3f4& b) {
-		v[0] = a.v[1] * b.v[2] - a.v[2] * b.v[1];
-		v[1] = a.v[2] * b.v[0] - a.v[0] * b.v[2];
-		v[2] = a.v[0] * b.v[1] - a.v[1] * b.v[0];
+	inline void cross(const SIMDVector3& a, const SIMDVector3& b) {
+		*this = a % b;
 	}
 
 	//cross product
-	inline const Vector3f4 operator % (const Vector3f4& a) const {
-		return Vector3f4(v[1] * a.v[2] - v[2] * a.v[1],
-			v[2] * a.v[0] - v[0] * a.v[2],
-			v[0] * a.v[1] - v[1] * a.v[0]);
+	inline const SIMDVector3 operator % (const SIMDVector3& a) const {
+		return SIMDVector3(multiplySub(v[1] * a.v[2], v[2], a.v[1]),
+			multiplySub(v[2] * a.v[0], v[0], a.v[2]),
+			multiplySub(v[0] * a.v[1], v[1], a.v[0]));
 	}
 
-	inline const Vector3f4 operator * (Scalarf4 s) const {
-		return Vector3f4(v[0] * s, v[1] * s, v[2] * s);
+	inline const SIMDVector3 operator * (Scalar s) const {
+		return SIMDVector3(v[0] * s, v[1] * s, v[2] * s);
 	}
 
-	inline Vector3f4& operator *= (Scalarf4 s) {
+	inline SIMDVector3& operator *= (Scalar s) {
 		v[0] *= s;
 		v[1] *= s;
 		v[2] *= s;
 		return *this;
 	}
 
-	inline const Vector3f4 operator / (Scalarf4 s) const {
-		return Vector3f4(v[0] / s, v[1] / s, v[2] / s);
+	inline const SIMDVector3 operator / (Scalar s) const {
+		return SIMDVector3(v[0] / s, v[1] / s, v[2] / s);
 	}
 
-	inline Vector3f4& operator /= (Scalarf4 s) {
+	inline SIMDVector3& operator /= (Scalar s) {
 		v[0] = v[0] / s;
 		v[1] = v[1] / s;
 		v[2] = v[2] / s;
 		return *this;
 	}
 
-	inline const Vector3f4 operator + (const Vector3f4& a) const {
-		return Vector3f4(v[0] + a.v[0], v[1] + a.v[1], v[2] + a.v[2]);
+	inline const SIMDVector3 operator + (const SIMDVector3& a) const {
+		return SIMDVector3(v[0] + a.v[0], v[1] + a.v[1], v[2] + a.v[2]);
 	}
 
-	inline Vector3f4& operator += (const Vector3f4& a) {
+	inline SIMDVector3& operator += (const SIMDVector3& a) {
 		v[0] += a.v[0];
 		v[1] += a.v[1];
 		v[2] += a.v[2];
 		return *this;
 	}
 
-	inline const Vector3f4 operator - (const Vector3f4& a) const {
-		return Vector3f4(v[0] - a.v[0], v[1] - a.v[1], v[2] - a.v[2]);
+	inline const SIMDVector3 operator - (const SIMDVector3& a) const {
+		return SIMDVector3(v[0] - a.v[0], v[1] - a.v[1], v[2] - a.v[2]);
 	}
 
-	inline Vector3f4& operator -= (const Vector3f4& a) {
+	inline SIMDVector3& operator -= (const SIMDVector3& a) {
 		v[0] -= a.v[0];
 		v[1] -= a.v[1];
 		v[2] -= a.v[2];
 		return *this;
 	}
 
-	inline const Vector3f4 operator - () const {
-		return Vector3f4(Scalarf4(-1.0) * v[0], Scalarf4(-1.0) * v[1], Scalarf4(-1.0) * v[2]);
+	inline const SIMDVector3 operator - () const {
+		return SIMDVector3(Scalar(-1.0) * v[0], Scalar(-1.0) * v[1], Scalar(-1.0) * v[2]);
 	}
 
-	inline Scalarf4 lengthSquared() const {
-		return v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+	inline Scalar lengthSquared() const {
+		return dot(*this);
 	}
 
-	//does the same as for (int i = 0; i < 4; i++) result[i] = c[i] ? a[i] : b[i];
+	//does the same as for (int i = 0; i < Scalar::WIDTH; i++) result[i] = c[i] ? a[i] : b[i];
 	//the elemets in c must be either 0 (false) or 0xFFFFFFFF (true)
-	static inline Vector3f4 blend(Scalarf4 const & c, Vector3f4 const & a, Vector3f4 const & b) {
-		Vector3f4 result;
-		result.x() = vbslq_f32(reinterpret_cast<uint32x4_t>(c.v), a.x().v, b.x().v);
-		result.y() = vbslq_f32(reinterpret_cast<uint32x4_t>(c.v), a.y().v, b.y().v);
-		result.z() = vbslq_f32(reinterpret_cast<uint32x4_t>(c.v), a.z().v, b.z().v);
+	static inline SIMDVector3 blend(Scalar const & c, SIMDVector3 const & a, SIMDVector3 const & b) {
+		SIMDVector3 result;
+		result.x() = SIMD_SCOPE::blend(c, a.x(), b.x());
+		result.y() = SIMD_SCOPE::blend(c, a.y(), b.y());
+		result.z() = SIMD_SCOPE::blend(c, a.z(), b.z());
 		return result;
 	}
 };
 
 
 // ----------------------------------------------------------------------------------------------
-//3x3 dimensional matrix of Scalar8f to represent 4 3x3 matrices
-class Matrix3f4
+//3x3 dimensional matrix of Scalar to represent Scalar::WIDTH 3x3 matrices
+template <class Scalar>
+class SIMDMatrix3
 {
 public:
-	Scalarf4 m[3][3];
+	Scalar m[3][3];
 
-	Matrix3f4() {  }
+	SIMDMatrix3() {  }
 
 	//constructor to create matrix from 3 column vectors
-	Matrix3f4(const Vector3f4& m1, const Vector3f4& m2, const Vector3f4& m3)
+	SIMDMatrix3(const SIMDVector3<Scalar>& m1, const SIMDVector3<Scalar>& m2, const SIMDVector3<Scalar>& m3)
 	{
 		m[0][0] = m1.x();
 		m[1][0] = m1.y();
@@ -252,55 +181,46 @@ public:
 		m[2][2] = m3.z();
 	}
 
-	inline Scalarf4& operator()(int i, int j) { return m[i][j]; }
+	inline Scalar& operator()(int i, int j) { return m[i][j]; }
 
-	inline void setCol(int i, const Vector3f4& v)
+	inline void setCol(int i, const SIMDVector3<Scalar>& v)
 	{
 		m[0][i] = v.x();
 		m[1][i] = v.y();
 		m[2][i] = v.z();
 	}
 
-	inline void setCol(int i, const Scalarf4& x, const Scalarf4& y, const Scalarf4& z)
+	inline void setCol(int i, const Scalar& x, const Scalar& y, const Scalar& z)
 	{
 		m[0][i] = x;
 		m[1][i] = y;
 		m[2][i] = z;
 	}
 
-	inline Vector3f4 operator * (const Vector3f4 &b) const
+	inline SIMDVector3<Scalar> operator * (const SIMDVector3<Scalar> &b) const
 	{
-		Vector3f4 A;
+		SIMDVector3<Scalar> A;
 
-		A.v[0] = m[0][0] * b.v[0] + m[0][1] * b.v[1] + m[0][2] * b.v[2];
-		A.v[1] = m[1][0] * b.v[0] + m[1][1] * b.v[1] + m[1][2] * b.v[2];
-		A.v[2] = m[2][0] * b.v[0] + m[2][1] * b.v[1] + m[2][2] * b.v[2];
+		for (int i = 0; i < 3; i++)
+			A.v[i] = multiplyAdd(multiplyAdd(m[i][0] * b.v[0], m[i][1], b.v[1]), m[i][2], b.v[2]);
 
 		return A;
 	}
 
-	inline Matrix3f4 operator * (const Matrix3f4 &b) const
+	inline SIMDMatrix3 operator * (const SIMDMatrix3 &b) const
 	{
-		Matrix3f4 A;
-
-		A.m[0][0] = m[0][0] * b.m[0][0] + m[0][1] * b.m[1][0] + m[0][2] * b.m[2][0];
-		A.m[0][1] = m[0][0] * b.m[0][1] + m[0][1] * b.m[1][1] + m[0][2] * b.m[2][1];
-		A.m[0][2] = m[0][0] * b.m[0][2] + m[0][1] * b.m[1][2] + m[0][2] * b.m[2][2];
+		SIMDMatrix3 A;
 
-		A.m[1][0] = m[1][0] * b.m[0][0] + m[1][1] * b.m[1][0] + m[1][2] * b.m[2][0];
-		A.m[1][1] = m[1][0] * b.m[0][1] + m[1][1] * b.m[1][1] + m[1][2] * b.m[2][1];
-		A.m[1][2] = m[1][0] * b.m[0][2] + m[1][1] * b.m[1][2] + m[1][2] * b.m[2][2];
-
-		A.m[2][0] = m[2][0] * b.m[0][0] + m[2][1] * b.m[1][0] + m[2][2] * b.m[2][0];
-		A.m[2][1] = m[2][0] * b.m[0][1] + m[2][1] * b.m[1][1] + m[2][2] * b.m[2][1];
-		A.m[2][2] = m[2][0] * b.m[0][2] + m[2][1] * b.m[1][2] + m[2][2] * b.m[2][2];
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				A.m[i][j] = multiplyAdd(multiplyAdd(m[i][0] * b.m[0][j], m[i][1], b.m[1][j]), m[i][2], b.m[2][j]);
 
 		return A;
 	}
 
-	inline Matrix3f4 transpose() const
+	inline SIMDMatrix3 transpose() const
 	{
-		Matrix3f4 A;
+		SIMDMatrix3 A;
 		A.m[0][0] = m[0][0]; A.m[0][1] = m[1][0]; A.m[0][2] = m[2][0];
 		A.m[1][0] = m[0][1]; A.m[1][1] = m[1][1]; A.m[1][2] = m[2][1];
 		A.m[2][0] = m[0][2]; A.m[2][1] = m[1][2]; A.m[2][2] = m[2][2];
@@ -308,7 +228,7 @@ public:
 		return A;
 	}
 
-	inline Scalarf4 determinant() const
+	inline Scalar determinant() const
 	{
 		return  m[0][1] * m[1][2] * m[2][0] - m[0][2] * m[1][1] * m[2][0] + m[0][2] * m[1][0] * m[2][1] 
 			  - m[0][0] * m[1][2] * m[2][1] - m[0][1] * m[1][0] * m[2][2] + m[0][0] * m[1][1] * m[2][2];
@@ -320,9 +240,9 @@ public:
 		{
 			for (int j = 0; j < 3; j++)
 			{
-				float val[4];
+				float val[Scalar::WIDTH];
 				m[i][j].store(val);
-				for (int k = 0; k < 4; k++)
+				for (int k = 0; k < Scalar::WIDTH; k++)
 					Mf[k](i, j) = val[k];
 			}
 		}
@@ -330,105 +250,106 @@ public:
 };
 
 // ----------------------------------------------------------------------------------------------
-//4 dimensional vector of Scalar8f to represent 4 quaternions
-class Quaternion4f 
+//4 dimensional vector of Scalar to represent Scalar::WIDTH quaternions
+template <class Scalar>
+class SIMDQuaternion
 {
 public:
 
-	Scalarf4  q[4];
+	Scalar  q[4];
 
-	inline Quaternion4f() { q[0] = 0.0; q[1] = 0.0; q[2] = 0.0; q[3] = 1.0; }
+	inline SIMDQuaternion() { q[0] = 0.0; q[1] = 0.0; q[2] = 0.0; q[3] = 1.0; }
 
-	inline Quaternion4f(Scalarf4 x, Scalarf4 y, Scalarf4 z, Scalarf4 w) {
+	inline SIMDQuaternion(Scalar x, Scalar y, Scalar z, Scalar w) {
 		q[0] = x; q[1] = y; q[2] = z; q[3] = w;
 	}
 
-	inline Quaternion4f(Vector3f4& v) {
+	inline SIMDQuaternion(SIMDVector3<Scalar>& v) {
 		q[0] = v[0]; q[1] = v[1]; q[2] = v[2]; q[3] = 0.0;
 	}
 
-	inline Scalarf4 & operator [] (int i) { return q[i]; }
-	inline Scalarf4   operator [] (int i) const { return q[i]; }
+	inline Scalar & operator [] (int i) { return q[i]; }
+	inline Scalar   operator [] (int i) const { return q[i]; }
 
-	inline Scalarf4 & x() { return q[0]; }
-	inline Scalarf4 & y() { return q[1]; }
-	inline Scalarf4 & z() { return q[2]; }
-	inline Scalarf4 & w() { return q[3]; }
+	inline Scalar & x() { return q[0]; }
+	inline Scalar & y() { return q[1]; }
+	inline Scalar & z() { return q[2]; }
+	inline Scalar & w() { return q[3]; }
 
-	inline Scalarf4 x() const { return q[0]; }
-	inline Scalarf4 y() const { return q[1]; }
-	inline Scalarf4 z() const { return q[2]; }
-	inline Scalarf4 w() const { return q[3]; }
+	inline Scalar x() const { return q[0]; }
+	inline Scalar y() const { return q[1]; }
+	inline Scalar z() const { return q[2]; }
+	inline Scalar w() const { return q[3]; }
 
-	inline const Quaternion4f operator*(const Quaternion4f& a) const {
+	inline const SIMDQuaternion operator*(const SIMDQuaternion& a) const {
 		return
-			Quaternion4f(q[3] * a.q[0] + q[0] * a.q[3] + q[1] * a.q[2] - q[2] * a.q[1],
+			SIMDQuaternion(q[3] * a.q[0] + q[0] * a.q[3] + q[1] * a.q[2] - q[2] * a.q[1],
 				q[3] * a.q[1] - q[0] * a.q[2] + q[1] * a.q[3] + q[2] * a.q[0],
 				q[3] * a.q[2] + q[0] * a.q[1] - q[1] * a.q[0] + q[2] * a.q[3],
 				q[3] * a.q[3] - q[0] * a.q[0] - q[1] * a.q[1] - q[2] * a.q[2]);
 	}
 
-	inline void toRotationMatrix(Matrix3f4& R)
+	inline void toRotationMatrix(SIMDMatrix3<Scalar>& R)
 	{
-		const Scalarf4 tx = Scalarf4(2.0) * q[0];
-		const Scalarf4 ty = Scalarf4(2.0) * q[1];
-		const Scalarf4 tz = Scalarf4(2.0) * q[2];
-		const Scalarf4 twx = tx*q[3];
-		const Scalarf4 twy = ty*q[3];
-		const Scalarf4 twz = tz*q[3];
-		const Scalarf4 txx = tx*q[0];
-		const Scalarf4 txy = ty*q[0];
-		const Scalarf4 txz = tz*q[0];
-		const Scalarf4 tyy = ty*q[1];
-		const Scalarf4 tyz = tz*q[1];
-		const Scalarf4 tzz = tz*q[2];
-
-	    R.m[0][0] = Scalarf4(1.0) - (tyy + tzz);
+		const Scalar tx = Scalar(2.0) * q[0];
+		const Scalar ty = Scalar(2.0) * q[1];
+		const Scalar tz = Scalar(2.0) * q[2];
+		const Scalar twx = tx*q[3];
+		const Scalar twy = ty*q[3];
+		const Scalar twz = tz*q[3];
+		const Scalar txx = tx*q[0];
+		const Scalar txy = ty*q[0];
+		const Scalar txz = tz*q[0];
+		const Scalar tyy = ty*q[1];
+		const Scalar tyz = tz*q[1];
+		const Scalar tzz = tz*q[2];
+
+	    R.m[0][0] = Scalar(1.0) - (tyy + tzz);
 		R.m[0][1] = txy - twz;
 		R.m[0][2] = txz + twy;
 		R.m[1][0] = txy + twz;
-		R.m[1][1] = Scalarf4(1.0) - (txx + tzz);
+		R.m[1][1] = Scalar(1.0) - (txx + tzz);
 		R.m[1][2] = tyz - twx;
 		R.m[2][0] = txz - twy;
 		R.m[2][1] = tyz + twx;
-		R.m[2][2] = Scalarf4(1.0) - (txx + tyy);
+		R.m[2][2] = Scalar(1.0) - (txx + tyy);
 	}
 
-	inline void toRotationMatrix(Vector3f4& R1, Vector3f4& R2, Vector3f4& R3)
+	inline void toRotationMatrix(SIMDVector3<Scalar>& R1, SIMDVector3<Scalar>& R2, SIMDVector3<Scalar>& R3)
 	{
-		const Scalarf4 tx = Scalarf4(2.0) * q[0];
-		const Scalarf4 ty = Scalarf4(2.0) * q[1];
-		const Scalarf4 tz = Scalarf4(2.0) * q[2];
-		const Scalarf4 twx = tx*q[3];
-		const Scalarf4 twy = ty*q[3];
-		const Scalarf4 twz = tz*q[3];
-		const Scalarf4 txx = tx*q[0];
-		const Scalarf4 txy = ty*q[0];
-		const Scalarf4 txz = tz*q[0];
-		const Scalarf4 tyy = ty*q[1];
-		const Scalarf4 tyz = tz*q[1];
-		const Scalarf4 tzz = tz*q[2];
-
-		R1[0] = Scalarf4(1.0) - (tyy + tzz);
+		const Scalar tx = Scalar(2.0) * q[0];
+		const Scalar ty = Scalar(2.0) * q[1];
+		const Scalar tz = Scalar(2.0) * q[2];
+		const Scalar twx = tx*q[3];
+		const Scalar twy = ty*q[3];
+		const Scalar twz = tz*q[3];
+		const Scalar txx = tx*q[0];
+		const Scalar txy = ty*q[0];
+		const Scalar txz = tz*q[0];
+		const Scalar tyy = ty*q[1];
+		const Scalar tyz = tz*q[1];
+		const Scalar tzz = tz*q[2];
+
+		R1[0] = Scalar(1.0) - (tyy + tzz);
 		R2[0] = txy - twz;
 		R3[0] = txz + twy;
 		R1[1] = txy + twz;
-		R2[1] = Scalarf4(1.0) - (txx + tzz);
+		R2[1] = Scalar(1.0) - (txx + tzz);
 		R3[1] = tyz - twx;
 		R1[2] = txz - twy;
 		R2[2] = tyz + twx;
-		R3[2] = Scalarf4(1.0) - (txx + tyy);
+		R3[2] = Scalar(1.0) - (txx + tyy);
 	}
 
 	inline void store(std::vector<EigenQuaternion>& qf) const
 	{
-		float x[4], y[4], z[4], w[4];
+		float x[Scalar::WIDTH], y[Scalar::WIDTH], z[Scalar::WIDTH], w[Scalar::WIDTH];
 		q[0].store(x);
 		q[1].store(y);
 		q[2].store(z);
 		q[3].store(w);
 
-		for (int i = 0; i < 4; i++)
+		for (int i = 0; i < Scalar::WIDTH; i++)
 		{
 			qf[i].x() = x[i];
 			qf[i].y() = y[i];
@@ -439,15 +360,15 @@ public:
 
 	inline void set(const std::vector<EigenQuaternion>& qf)
 	{
-		float x[4], y[4], z[4], w[4];
-		for(int i=0; i<4; i++)
+		float x[Scalar::WIDTH], y[Scalar::WIDTH], z[Scalar::WIDTH], w[Scalar::WIDTH];
+		for(int i=0; i<Scalar::WIDTH; i++)
 		{
 			x[i] = static_cast<float>(qf[i].x());
 			y[i] = static_cast<float>(qf[i].y());
 			z[i] = static_cast<float>(qf[i].z());
 			w[i] = static_cast<float>(qf[i].w());
 		}
-		Scalarf4 s;
+		Scalar s;
 		s.load(x);
 		q[0] = s;
 		s.load(y);
@@ -459,6 +380,41 @@ public:
 	}
 };
 
+// ----------------------------------------------------------------------------------------------
+//multiply-accumulate on 3d vectors. a chain like a * s0 + b * s1 + c * s2 is written as
+//multiplyAdd(multiplyAdd(a * s0, b, s1), c, s2), which needs no temporaries for the products
+//and turns into fused multiply-adds on the instruction sets that have them
+
+//a + b * s
+template <class Scalar>
+static inline SIMDVector3<Scalar> multiplyAdd(SIMDVector3<Scalar> const & a, SIMDVector3<Scalar> const & b, Scalar const & s) {
+	return SIMDVector3<Scalar>(multiplyAdd(a.v[0], b.v[0], s), multiplyAdd(a.v[1], b.v[1], s), multiplyAdd(a.v[2], b.v[2], s));
+}
+
+//a - b * s
+template <class Scalar>
+static inline SIMDVector3<Scalar> multiplySub(SIMDVector3<Scalar> const & a, SIMDVector3<Scalar> const & b, Scalar const & s) {
+	return SIMDVector3<Scalar>(multiplySub(a.v[0], b.v[0], s), multiplySub(a.v[1], b.v[1], s), multiplySub(a.v[2], b.v[2], s));
+}
+
+typedef SIMDVector3<Scalarf4> Vector3f4;
+typedef SIMDMatrix3<Scalarf4> Matrix3f4;
+typedef SIMDQuaternion<Scalarf4> Quaternion4f;
+
+#if defined(__AVX2__) && !defined(SIMD_SCALAR)
+typedef SIMDVector3<Scalarf8> Vector3f8;
+typedef SIMDMatrix3<Scalarf8> Matrix3f8;
+typedef SIMDQuaternion<Scalarf8> Quaternion8f;
+#endif
+
+#if defined(__AVX512F__) && !defined(SIMD_SCALAR)
+typedef SIMDVector3<Scalarf16> Vector3f16;
+typedef SIMDMatrix3<Scalarf16> Matrix3f16;
+typedef SIMDQuaternion<Scalarf16> Quaternion16f;
+#endif
+
+SIMD_NAMESPACE_END
+
 // ----------------------------------------------------------------------------------------------
 //alligned allocator so that vectorized types can be used in std containers
 //from: https://stackoverflow.com/questions/8456236/how-is-a-vectors-data-aligned
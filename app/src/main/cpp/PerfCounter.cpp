@@ -0,0 +1,96 @@
+#include "PerfCounter.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+static int openCounter(uint64_t config, int groupFd) {
+
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = groupFd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return (int) syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+PerfCounter::PerfCounter() : cyclesFd(-1), instructionsFd(-1), cycles(0), instructions(0) {
+
+}
+
+PerfCounter::~PerfCounter() {
+    finalize();
+}
+
+bool PerfCounter::initialize() {
+
+    finalize();
+
+    cyclesFd = openCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (cyclesFd < 0)
+        return false;
+
+    instructionsFd = openCounter(PERF_COUNT_HW_INSTRUCTIONS, cyclesFd);
+    if (instructionsFd < 0) {
+        finalize();
+        return false;
+    }
+
+    return true;
+}
+
+void PerfCounter::finalize() {
+
+    if (instructionsFd >= 0)
+        close(instructionsFd);
+    if (cyclesFd >= 0)
+        close(cyclesFd);
+
+    cyclesFd = -1;
+    instructionsFd = -1;
+}
+
+bool PerfCounter::isAvailable() const {
+    return cyclesFd >= 0;
+}
+
+void PerfCounter::start() {
+
+    if (!isAvailable())
+        return;
+
+    ioctl(cyclesFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(cyclesFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounter::stop() {
+
+    if (!isAvailable())
+        return;
+
+    ioctl(cyclesFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // group layout: number of counters followed by their values in the order they were opened
+    uint64_t values[3] = {0, 0, 0};
+    if (read(cyclesFd, values, sizeof(values)) < (ssize_t) sizeof(values))
+        return;
+
+    cycles = values[1];
+    instructions = values[2];
+}
+
+uint64_t PerfCounter::getCycles() const {
+    return this->cycles;
+}
+
+uint64_t PerfCounter::getInstructions() const {
+    return this->instructions;
+}
@@ -0,0 +1,38 @@
+#ifndef FEMFORANDROID_PERF_COUNTER_H
+#define FEMFORANDROID_PERF_COUNTER_H
+
+#include <cstdint>
+
+using namespace std;
+
+// hardware cycle and instruction counters of the calling thread through perf_event_open.
+// the kernel may refuse them (perf_event_paranoid, missing PMU access on many phones),
+// then isAvailable() is false and the callers fall back to wall clock time
+class PerfCounter {
+private:
+    int cyclesFd;
+    int instructionsFd;
+
+    uint64_t cycles;
+    uint64_t instructions;
+public:
+    PerfCounter();
+    ~PerfCounter();
+
+    PerfCounter(PerfCounter const&) = delete;
+    void operator=(PerfCounter const&) = delete;
+
+    bool initialize();
+    void finalize();
+
+    bool isAvailable() const;
+
+    void start();
+    void stop();
+
+    // counts between the last start() and stop()
+    uint64_t getCycles() const;
+    uint64_t getInstructions() const;
+};
+
+#endif //FEMFORANDROID_PERF_COUNTER_H
@@ -2,12 +2,16 @@
 
 #include <unistd.h>
 
+#include "ConstraintColoring.h"
+#include "FactorCache.h"
+#include "KernelDispatch.h"
+#include "PerfCounter.h"
+#include "ReferenceSolver.h"
+#include "TetBatching.h"
+
 #include "log.h"
 #include "exceptionUtils.h"
 
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
 extern "C" {
 #include "generalUtils.h"
 }
@@ -17,7 +21,7 @@ extern "C" {
 using namespace Eigen;
 
 Physics::Physics() {
-
+    pthread_mutex_init(&materialMutex, nullptr);
 }
 
 void Physics::initialize() {
@@ -25,24 +29,93 @@ void Physics::initialize() {
     if (this->initialized == 1)
         return;
 
+    double startTime = getTime();
+
     gravity = EigenVector3(0, 0, -1) * 9.8f;
     gravity.normalize();
 
+    material = config.material;
+
     wallsPosition = EigenVector3(0, 0, 0);
     wallsSize = 4.3f;
 
     walls = AssetManager::getInstance().loadMeshBinAsset("cube.meshbin", wallsPosition, wallsSize, EigenQuaternion(1, 0, 0, 0));
-    model = AssetManager::getInstance().loadTetBinAsset("model.tetbin", EigenVector3(0, 0, 0), 1.0f, EigenQuaternion(1, 0, 0, 0));
+
+    //bodies of the same shape share its factorization
+    for (size_t b = 0; b < config.bodies.size(); b++) {
+        const BodyConfig& bodyConfig = config.bodies[b];
+
+        Body body;
+        body.model = AssetManager::getInstance().loadTetBinAsset(bodyConfig.assetName, bodyConfig.position, bodyConfig.scale,
+                EigenQuaternion(bodyConfig.rotation), config.meshOrdering);
+        body.factor = nullptr;
+        body.group = nullptr;
+
+        for (size_t f = 0; f < factors.size() && !body.factor; f++)
+            if (factors[f]->shapeHash == body.model->getShapeHash())
+                body.factor = factors[f];
+
+        if (!body.factor) {
+            body.factor = new BodyFactor();
+            body.factor->shapeHash = body.model->getShapeHash();
+            body.factor->model = body.model;
+            factors.push_back(body.factor);
+        }
+
+        bodies.push_back(body);
+    }
 
     loadSimulationState();
 
-    this->initializeModel();
+    print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Assets loaded in %.1f ms, preparing the solver in the background",
+              (getTime() - startTime) * 1000.0);
+
+    //the assembly, the factorization and the coloring don't hold up the first frame
+    solverReady = false;
+    pthread_check_error(pthread_create(&initThread, nullptr, init_thread_entrypoint, nullptr));
 
     this->initialized = 1;
+}
+
+void* Physics::init_thread_entrypoint(void* opaque) {
+
+    Physics::getInstance().initializeSolver();
+    return nullptr;
+}
+
+//runs on the init thread. the renderer only reads the vertices of the bodies meanwhile
+void Physics::initializeSolver() {
+
+    double startTime = getTime();
+
+    workerPool.initialize(config.threadCount > 0 ? config.threadCount : WorkerPool::getDefaultThreadCount());
+
+    selectKernels();
+
+    timeStepLevelCount = std::min(std::max(config.timeStepLevels, 1), MAX_TIME_STEP_LEVELS);
+    timeStepLevel = 0;
+    stepDt = dt;
+    substepTime = 0.0;
+
+    this->initializeModel();
+
+    if (config.validationSteps > 0)
+        validate(config.validationSteps);
+
+    //the substeps of the validation are not timed
+    timings = SubstepTimings();
+
+    print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Solver ready in %.1f ms", (getTime() - startTime) * 1000.0);
+
+    solverReady.store(true, memory_order_release);
 
     // benchmark();
 }
 
+bool Physics::isSolverReady() const {
+    return solverReady.load(memory_order_acquire);
+}
+
 void Physics::benchmark() {
 
     const int STEPS_COUNT = 15000;
@@ -60,50 +133,449 @@ void Physics::benchmark() {
     double ratio = elapsedSimulated / elapsed;
 
     print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Ratio: %f", ratio);
+
+    // benchmark();
+}
+
+//cost of one batch of both local step kernels on the physics thread alone
+void Physics::benchmarkLocalStep() {
+
+    const int REPETITIONS = 200;
+
+    PerfCounter counter;
+    if (!counter.initialize())
+        print_log(ANDROID_LOG_WARN, PHYSICS_TAG, "Cycle counters are not available, measuring time only");
+
+    for (int kernel = SplitLocalStep; kernel <= FusedLocalStep; kernel++) {
+        for (size_t i = 0; i < nVerts; i++)
+            RHS[i] = Scalarf4(0.0f);
+
+        void (*localStep)(const KernelData&, int, int, float*) = kernel == FusedLocalStep ? kernels.localStep : kernels.localStepSplit;
+
+        counter.start();
+        double startTime = getTime();
+
+        for (int r = 0; r < REPETITIONS; r++)
+            localStep(kernelData, 0, vecSize, (float*) RHS.data());
+
+        double elapsed = getTime() - startTime;
+        counter.stop();
+
+        double batches = (double) REPETITIONS * vecSize;
+        const char* name = kernel == FusedLocalStep ? "fused" : "split";
+
+        if (counter.isAvailable()) {
+            print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Local step (%s, %d lanes): %.1f cycles, %.1f instructions, %.1f ns per batch",
+                      name, kernels.laneWidth, counter.getCycles() / batches, counter.getInstructions() / batches, elapsed * 1.0e9 / batches);
+        } else {
+            print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Local step (%s, %d lanes): %.1f ns per batch",
+                      name, kernels.laneWidth, elapsed * 1.0e9 / batches);
+        }
+    }
 }
 
+//instructions, time and error of the same deformation gradient and Hessian determinant expressions with separate
+//multiplications and additions and with the multiply-accumulate functions of NEON_math.h. the error is the largest
+//difference of det(H) to the double precision result over all lanes
+void Physics::benchmarkExpressions() {
+
+    const int REPETITIONS = 200;
+
+    PerfCounter counter;
+    bool counted = counter.initialize();
+
+    const size_t count = (size_t) vecSize * kernels.laneWidth;
+    vector<float> determinants(count);
+    vector<double> reference(count);
+    double instructions[2], times[2], errors[2];
+
+    kernels.referenceExpressions(kernelData, 0, vecSize, reference.data());
+
+    for (int fused = 0; fused < 2; fused++) {
+        counter.start();
+        double startTime = getTime();
+
+        for (int r = 0; r < REPETITIONS; r++)
+            kernels.measureExpressions(kernelData, 0, vecSize, fused != 0, determinants.data());
+
+        times[fused] = (getTime() - startTime) * 1.0e9 / ((double) REPETITIONS * vecSize);
+        counter.stop();
+
+        instructions[fused] = counter.getInstructions() / ((double) REPETITIONS * vecSize);
+
+        errors[fused] = 0.0;
+        for (size_t i = 0; i < count; i++)
+            errors[fused] = std::max(errors[fused], fabs(determinants[i] - reference[i]));
+    }
+
+    if (counted) {
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Expressions (%s): %.1f -> %.1f instructions (%.1f%% fewer), %.1f -> %.1f ns per batch, error %e -> %e",
+                  kernels.name, instructions[0], instructions[1], 100.0 * (1.0 - instructions[1] / instructions[0]), times[0], times[1],
+                  errors[0], errors[1]);
+    } else {
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Expressions (%s): %.1f -> %.1f ns per batch, error %e -> %e",
+                  kernels.name, times[0], times[1], errors[0], errors[1]);
+    }
+}
+
+//runs the same mesh with every kernel set the CPU supports. the batches are rebuilt
+//for each lane width, the selected kernels are restored afterwards
+void Physics::benchmarkKernels() {
+
+    const int STEPS_COUNT = 2000;
+
+    vector<SolverKernelTable> available;
+    KernelDispatch::getAvailable(available);
+
+    SolverKernelTable selected = kernels;
+
+    for (size_t i = 0; i < available.size(); i++) {
+        switchKernels(available[i]);
+
+        double startTime = getTime();
+
+        for (int step = 0; step < STEPS_COUNT; step++)
+            subStep();
+
+        double elapsed = getTime() - startTime;
+
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Kernels %s (%d lanes): %.1f us per substep, ratio %f",
+                  kernels.name, kernels.laneWidth, elapsed * 1.0e6 / STEPS_COUNT, STEPS_COUNT * dt / elapsed);
+
+        benchmarkLocalStep();
+        benchmarkExpressions();
+    }
+
+    switchKernels(selected);
+}
+
+//largest distance between the positions of the solver and the ones of a reference solver
+template <typename Real>
+double Physics::computeDivergence(const Positions& p, const vector<Eigen::Matrix<Real, 3, 1>>& reference) {
+
+    double divergence = 0.0;
+    for (size_t i = 0; i < reference.size(); i++) {
+        Eigen::Vector3d d(p.x[i] - (double) reference[i].x(), p.y[i] - (double) reference[i].y(), p.z[i] - (double) reference[i].z());
+        divergence = std::max(divergence, d.norm());
+    }
+
+    return divergence;
+}
+
+//runs the substep next to the scalar reference solvers in float and double, starting from the rest pose,
+//and logs the divergence of the positions after every substep and the speedup of the kernels.
+//the bodies are put back into their rest pose afterwards
+void Physics::validate(int steps) {
+
+    vector<EigenVector3> restPose(nVerts);
+    for (int i = 0; i < nVerts; i++)
+        restPose[i] = EigenVector3(positions.x[i], positions.y[i], positions.z[i]);
+
+    //the tets of the instances follow the batched ones, instance by instance for every tet of the shape.
+    //their constraints are solved in the order of group.tets, the phases of the shape, with the instances
+    //of a tet one after another like solveConstraintsInstanced does
+    vector<vector<int>> ind = tets;
+    vector<int> instanceConstraintOrder;
+    for (size_t g = 0; g < instanceGroups.size(); g++) {
+        const InstanceGroupData& group = instanceGroups[g]->data;
+
+        for (unsigned int t = 0; t < group.tetCount; t++)
+            for (int k = 0; k < group.instanceCount; k++) {
+                vector<int> tet(4);
+                for (int j = 0; j < 4; j++)
+                    tet[j] = group.vertexOffset + group.tets[t].indices[j] * group.instanceCount + k;
+
+                instanceConstraintOrder.push_back((int) ind.size());
+                ind.push_back(tet);
+            }
+    }
+
+    ReferenceSettings settings;
+    settings.material = material;
+    settings.dt = dt;
+    settings.gravity = gravity;
+    settings.wallsPosition = wallsPosition;
+    settings.wallsSize = wallsSize;
+    settings.constraintIterations = VOLUME_CONSTRAINT_ITERATIONS;
+
+    //Gauss-Seidel in the order of the phases, the constraints of a phase are independent of each other.
+    //the instances are solved after the batched bodies, they don't share vertices with them
+    if (config.volumeConstraints == GaussSeidelConstraints) {
+        vector<vector<int>> phases;
+        ConstraintColoring::compute(tets, nBatchedVerts, kernels.laneWidth, phases);
+        for (size_t phase = 0; phase < phases.size(); phase++)
+            settings.constraintOrder.insert(settings.constraintOrder.end(), phases[phase].begin(), phases[phase].end());
+
+        settings.constraintOrder.insert(settings.constraintOrder.end(), instanceConstraintOrder.begin(),
+                                        instanceConstraintOrder.end());
+    }
+
+    ReferenceSolver<float> referenceFloat;
+    ReferenceSolver<double> referenceDouble;
+    referenceFloat.initialize(restPose, ind, settings);
+    referenceDouble.initialize(restPose, ind, settings);
+
+    double solverTime = 0.0, referenceTime = 0.0;
+    double maxDivergenceFloat = 0.0, maxDivergenceDouble = 0.0;
+
+    for (int step = 0; step < steps; step++) {
+        double startTime = getTime();
+        subStep();
+        solverTime += getTime() - startTime;
+
+        startTime = getTime();
+        referenceFloat.subStep();
+        referenceTime += getTime() - startTime;
+
+        referenceDouble.subStep();
+
+        double divergenceFloat = computeDivergence(positions, referenceFloat.getPositions());
+        double divergenceDouble = computeDivergence(positions, referenceDouble.getPositions());
+        maxDivergenceFloat = std::max(maxDivergenceFloat, divergenceFloat);
+        maxDivergenceDouble = std::max(maxDivergenceDouble, divergenceDouble);
+
+        print_log(ANDROID_LOG_DEBUG, PHYSICS_TAG, "Validation step %d: divergence %e (float), %e (double)",
+                  step, divergenceFloat, divergenceDouble);
+    }
+
+    print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Validation (%s, %d lanes): %d substeps, max divergence %e (float), %e (double), "
+              "%.1f us vs %.1f us per substep, speedup %.2f", kernels.name, kernels.laneWidth, steps,
+              maxDivergenceFloat, maxDivergenceDouble, solverTime * 1.0e6 / steps, referenceTime * 1.0e6 / steps,
+              referenceTime / solverTime);
+
+    for (int i = 0; i < nVerts; i++) {
+        positions.x[i] = restPose[i].x();
+        positions.y[i] = restPose[i].y();
+        positions.z[i] = restPose[i].z();
+    }
+    positions_old = positions;
+    //the renderer may be drawing the bodies meanwhile, the first substep publishes the rest pose otherwise
+    publishPositions();
+
+    //resets the rotations of the local step
+    initializeBatches();
+}
+
+//rebuilds the batches of the initialized bodies for other kernels
+void Physics::switchKernels(const SolverKernelTable& table) {
+
+    kernels = table;
+    for (size_t i = 0; i < triangularSolvers.size(); i++)
+        triangularSolvers[i].setRowKernels(kernels.solveTriangularRows, kernels.solveTriangularRowsInstanced);
+    for (size_t g = 0; g < instanceGroups.size(); g++)
+        for (size_t i = 0; i < instanceGroups[g]->triangularSolvers.size(); i++)
+            instanceGroups[g]->triangularSolvers[i].setRowKernels(kernels.solveTriangularRows, kernels.solveTriangularRowsInstanced);
+
+    batchTets(tets);
+    initializeBatches();
+}
+
+//picks the kernels once per initialize, the CPU features are checked at runtime
+void Physics::selectKernels() {
+
+    kernels = KernelDispatch::select(config.instructionSet, config.laneWidth);
+
+    if ((config.instructionSet != AutoKernels && kernels.instructionSet != config.instructionSet) ||
+        (config.instructionSet == AutoKernels && config.laneWidth > 0 && kernels.laneWidth != config.laneWidth)) {
+        print_log(ANDROID_LOG_WARN, PHYSICS_TAG, "The requested kernels are not available on this CPU");
+    }
+
+    print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Kernels: %s, %d lanes", kernels.name, kernels.laneWidth);
+}
+
+//packs neighbouring tets into the same batches of the lane width of the kernels,
+//the per-tet constants follow this order
+void Physics::batchTets(vector<vector<int>> &ind) {
+
+    const int W = kernels.laneWidth;
+
+    double uniqueBefore = TetBatching::computeAverageUniqueVertices(ind, W);
+    vector<int> batchOrder;
+    TetBatching::build(ind, nBatchedVerts, W, batchOrder);
+    TetBatching::apply(ind, batchOrder);
+    if (!tetConstants.empty())
+        TetBatching::apply(tetConstants, batchOrder);
+
+    //nothing to report if every body is instanced
+    if (nBatchedTets > 0)
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Tet batching: %.2f -> %.2f unique vertices per %d-tet batch",
+                  uniqueBefore, TetBatching::computeAverageUniqueVertices(ind, W), W);
+}
+
+//lays out the bodies in the solver, first the batched ones one after another, then the instance groups
+//with the vertices of their instances interleaved. every shape is factorized once, the system
+//of the batched bodies is block diagonal with the factors of their shapes
 void Physics::initializeModel() {
 
-    vector<EigenVector3>& p = model->getAllVertices();
-    vector<vector<int>>& ind = model->getTets();
+    //a shape is instanced once its bodies fill a whole SIMD block. fewer instances only fill a partial block,
+    //which gathers every tet and stores lane by lane, and are faster as blocks of the batched system
+    if (config.instanceBodies && config.volumeConstraints == GaussSeidelConstraints) {
+        for (size_t f = 0; f < factors.size(); f++) {
+            int instanceCount = 0;
+            for (size_t b = 0; b < bodies.size(); b++)
+                instanceCount += bodies[b].factor == factors[f];
 
-    // bread
-    float density = 190.0;
-    float E =  0.3 * 1.0e6;
-    float nu = 0.78;
+            if (instanceCount < std::max(kernels.laneWidth, 2))
+                continue;
 
-    /*
-    // copper
-    float density = 2810;
-    float E =  10 * 1.0e6;
-    float nu = 0.32;
-     */
+            InstanceGroup* group = new InstanceGroup();
+            group->factor = factors[f];
+            instanceGroups.push_back(group);
 
-    float mu = E / (2.0 * (1.0 + nu));
-    float lambda = (E*nu) / ((1.0 + nu) * (1.0 - 2.0 * nu));
+            for (size_t b = 0; b < bodies.size(); b++)
+                if (bodies[b].factor == factors[f])
+                    bodies[b].group = group;
+        }
+    }
 
-    nVerts = model->getAllVerticesCount();
-    nTets = model->getTetCount();
-    if (nTets % 4 == 0) vecSize = nTets / 4;
-    else vecSize = nTets / 4 + 1;
+    nVerts = 0;
+    nTets = 0;
+    for (size_t b = 0; b < bodies.size(); b++) {
+        Body& body = bodies[b];
+        if (body.group)
+            continue;
+
+        body.vertexOffset = nVerts;
+        body.vertexStride = 1;
+        body.vertexCount = body.model->getAllVerticesCount();
+        nVerts += body.vertexCount;
+        nTets += body.model->getTetCount();
+    }
+    nBatchedVerts = nVerts;
+    nBatchedTets = nTets;
+
+    for (size_t g = 0; g < instanceGroups.size(); g++) {
+        InstanceGroupData& group = instanceGroups[g]->data;
+        group.vertexOffset = nVerts;
+        group.instanceCount = 0;
+
+        for (size_t b = 0; b < bodies.size(); b++) {
+            Body& body = bodies[b];
+            if (body.group == instanceGroups[g])
+                body.vertexOffset = nVerts + group.instanceCount++;
+        }
 
-    vector<Triplet<float>> triplets_D;
-    triplets_D.reserve(9 * nTets * 4);
-    vector<Triplet<float>> triplets_K;
-    triplets_K.reserve(9 * nTets);
-    vector<Triplet<float>> triplets_M;
-    triplets_M.reserve(4 * nTets);
-    vector<float> Kreal(nTets);
-    vector<vector<vector<float>>> Dt(nTets);
-    vector<EigenMatrix3> Dm_inv(nTets);
-    vector<float> rest_volume(nTets);
-    vector<float> invMass(nVerts);
+        TetAsset* shape = instanceGroups[g]->factor->model;
+        for (size_t b = 0; b < bodies.size(); b++) {
+            Body& body = bodies[b];
+            if (body.group != instanceGroups[g])
+                continue;
+
+            body.vertexStride = group.instanceCount;
+            body.vertexCount = shape->getAllVerticesCount();
+        }
+
+        nVerts += shape->getAllVerticesCount() * group.instanceCount;
+        nTets += shape->getTetCount() * group.instanceCount;
+    }
+    nVertsPadded = (nVerts + 3) / 4 * 4;
+
+    //the factorizations are reused from the last start if the shapes, the material and the time steps are the same
+    double factorizationStart = getTime();
+    uint64_t shapesHash = HASH_INITIAL_VALUE;
+    for (size_t f = 0; f < factors.size(); f++)
+        shapesHash = hashBytes(&factors[f]->shapeHash, sizeof(factors[f]->shapeHash), shapesHash);
+
+    uint64_t cacheKey = FactorCache::computeKey(shapesHash, material, dt, timeStepLevelCount);
+    bool cached = loadFactorizations(cacheKey);
+    if (!cached) {
+        for (size_t f = 0; f < factors.size(); f++)
+            computeFactorization(*factors[f]);
+        saveFactorizations(cacheKey);
+    }
+
+    print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Factorization: %d shapes of %d bodies, %d time steps %s in %.1f ms",
+              (int) factors.size(), (int) bodies.size(), timeStepLevelCount,
+              cached ? "loaded from cache" : "computed", (getTime() - factorizationStart) * 1000.0);
+
+    //the tets, constants and masses of the batched bodies
+    tets.clear();
+    tets.reserve(nBatchedTets);
+    tetConstants.clear();
+    tetConstants.reserve(nBatchedTets);
+
+    for (size_t b = 0; b < bodies.size(); b++) {
+        const Body& body = bodies[b];
+        const BodyFactor& factor = *body.factor;
+        if (body.group)
+            continue;
+        const vector<vector<int>>& ind = body.model->getTets();
+
+        for (size_t t = 0; t < ind.size(); t++) {
+            vector<int> tet(4);
+            for (int j = 0; j < 4; j++)
+                tet[j] = ind[t][j] + body.vertexOffset;
+            tets.push_back(tet);
+        }
+
+        tetConstants.insert(tetConstants.end(), factor.tetConstants.begin(), factor.tetConstants.end());
+    }
+
+    combineInverseMasses(invMass);
+    initializePermutations();
+    combineFactors(matL);
+
+    //the per-tet constants follow the tets into the batch order
+    batchTets(tets);
+
+    initializeTriangularSolvers(matL, permInv, triangularSolvers);
+
+    const TriangularSolver& triangularSolver = triangularSolvers[0];
+    if (nBatchedTets > 0)
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Triangular solve: %d unknowns, %d non zeros, %d levels, %s on %d threads",
+                  triangularSolver.getSize(), triangularSolver.getNonZeros(), triangularSolver.getLevelCount(),
+                  triangularSolver.isParallel() ? "level scheduled" : "serial", workerPool.getThreadCount());
+
+    initializeInstanceGroups();
+
+    //prepare solver variables
+    positions.resize(nVertsPadded);
+    for (size_t b = 0; b < bodies.size(); b++) {
+        const Body& body = bodies[b];
+        const vector<EigenVector3>& p = body.model->getAllVertices();
+
+        for (int i = 0; i < body.vertexCount; i++) {
+            int v = body.vertexOffset + i * body.vertexStride;
+            positions.x[v] = p[i].x();
+            positions.y[v] = p[i].y();
+            positions.z[v] = p[i].z();
+        }
+    }
+    positions_old = positions;
+    RHS.assign(nVertsPadded, Scalarf4(0.0f));
+    threadRHS.resize(workerPool.getThreadCount() - 1);
+    for (size_t i = 0; i < threadRHS.size(); i++)
+        threadRHS[i].resize(nBatchedVerts);
+
+    initializeBatches();
+}
+
+//per-tet constants, inverse masses and the Cholesky factorizations of the system matrix of a shape
+void Physics::computeFactorization(BodyFactor& factor) {
+
+    const vector<EigenVector3>& p = factor.model->getAllVertices();
+    const vector<vector<int>>& ind = factor.model->getTets();
+    const int nVerts = factor.model->getAllVerticesCount();
+    const int nTets = factor.model->getTetCount();
+
+    float density = material.density;
+    float mu = material.getMu();
+    float lambda = material.getLambda();
+
+    vector<TetConstants>& tetConstants = factor.tetConstants;
+    vector<float>& invMass = factor.invMass;
+    vector<float>& lumpedMass = factor.lumpedMass;
+
+    tetConstants.resize(nTets);
+    invMass.assign(nVerts, 0.0f);
+    lumpedMass.assign(nVerts, 0.0f);
 
     //Algorithm 1, lines 1-12
     for (int t = 0; t < nTets; t++)
     {
         //indices of the 4 vertices of tet t
-        vector<int>& it = ind[t];
+        const vector<int>& it = ind[t];
+        TetConstants& tet = tetConstants[t];
 
         //compute rest pose shape matrix and volume
         EigenMatrix3 Dm;
@@ -111,238 +583,614 @@ void Physics::initializeModel() {
         Dm.col(1) = p[it[2]] - p[it[0]];
         Dm.col(2) = p[it[3]] - p[it[0]];
 
-        rest_volume[t] = 1.0 / 6.0 * Dm.determinant();
-        my_assert(rest_volume[t] >= 0.0);
+        tet.restVolume = 1.0 / 6.0 * Dm.determinant();
+        my_assert(tet.restVolume >= 0.0);
 
-        Dm_inv[t] = Dm.inverse();
+        tet.alpha = 1.0f / (float)(lambda * tet.restVolume * dt * dt);
 
-        //set triplets for the matrix K. Directly multiply the factor 2*dt*dt into K
-        Kreal[t] = 2.0 * dt * dt * mu * rest_volume[t];
+        EigenMatrix3 Dm_inv = Dm.inverse();
 
-        for (int j = 0; j < 9; j++)
-            triplets_K.push_back(Triplet<float>(9 * t + j, 9 * t + j, Kreal[t]));
+        //directly multiply the factor 2*dt*dt into K
+        tet.K = 2.0 * dt * dt * mu * tet.restVolume;
 
-        //initialize the lumped mass matrix
+        //initialize the lumped mass matrix. every corner adds the mass of its vertex so far
         for (int j = 0; j < 4; j++)		//forall verts of tet i
         {
-            invMass[it[j]] += 0.25 * density * rest_volume[t];
-            triplets_M.push_back(Triplet<float>(it[j], it[j], invMass[it[j]]));
+            invMass[it[j]] += 0.25 * density * tet.restVolume;
+            lumpedMass[it[j]] += invMass[it[j]] / density;
         }
 
-        //compute matrix D_t from Eq. (9) (actually Dt[t] is D_t^T)
-        Dt[t].resize(4);
-
-        Dt[t][0].resize(3);
+        //compute matrix D_t from Eq. (9) (actually tet.DT is D_t^T)
         for (int k = 0; k < 3; k++)
-            Dt[t][0][k] = -Dm_inv[t](0, k) - Dm_inv[t](1, k) - Dm_inv[t](2, k);
+            tet.DT[0][k] = -Dm_inv(0, k) - Dm_inv(1, k) - Dm_inv(2, k);
 
-        for (int j = 1; j < 4; j++) {
-            Dt[t][j].resize(3);
+        for (int j = 1; j < 4; j++)
             for (int k = 0; k < 3; k++)
-                Dt[t][j][k] = Dm_inv[t](j - 1, k);
-        }
+                tet.DT[j][k] = Dm_inv(j - 1, k);
+    }
+
+    //compute system matrix and Cholesky factorization (Algorithm 1, line 13)
+    factor.symbolicAnalysisDone = false;
+    bool factorized = factorizeLadder(factor, material, factor.matL);
+    my_assert(factorized);
+
+    const VectorXi& permutation = factor.LLT.permutationP().indices();
+    factor.permutation.assign(permutation.data(), permutation.data() + permutation.size());
+
+    for (size_t i = 0; i < invMass.size(); i++)
+        invMass[i] = 1.0 / invMass[i];
+}
+
+//inverse lumped masses of a shape for another material
+void Physics::computeInverseMasses(const BodyFactor& factor, const Material& material, vector<float>& invMass) {
+
+    const vector<vector<int>>& ind = factor.model->getTets();
+
+    invMass.assign(factor.model->getAllVerticesCount(), 0.0f);
+    for (size_t t = 0; t < ind.size(); t++)
+        for (int j = 0; j < 4; j++)
+            invMass[ind[t][j]] += 0.25 * material.density * factor.tetConstants[t].restVolume;
+
+    for (size_t i = 0; i < invMass.size(); i++)
+        invMass[i] = 1.0 / invMass[i];
+}
+
+//M + D^T * K * D of a shape for a material and time step from the shape constants of its tets and the lumped masses
+SparseMatrix<float> Physics::assembleSystemMatrix(const BodyFactor& factor, const Material& material, double timeStep) {
+
+    const vector<vector<int>>& ind = factor.model->getTets();
+    const int nVerts = factor.model->getAllVerticesCount();
+    const int nTets = factor.model->getTetCount();
+
+    float mu = material.getMu();
+
+    vector<Triplet<float>> triplets_D;
+    triplets_D.reserve(9 * nTets * 4);
+    vector<Triplet<float>> triplets_K;
+    triplets_K.reserve(9 * nTets);
+    vector<Triplet<float>> triplets_M;
+    triplets_M.reserve(nVerts);
+
+    for (int t = 0; t < nTets; t++)
+    {
+        const TetConstants& tet = factor.tetConstants[t];
+
+        //actually 2 * dt * dt * K
+        float K = 2.0 * timeStep * timeStep * mu * tet.restVolume;
+        for (int j = 0; j < 9; j++)
+            triplets_K.push_back(Triplet<float>(9 * t + j, 9 * t + j, K));
 
         //initialize the matrix D
         for (int i = 0; i < 4; i++)
             for (int j = 0; j < 3; j++)
-                triplets_D.push_back(Triplet<float>(9 * t + 3 * j, it[i], Dt[t][i][j]));
+                triplets_D.push_back(Triplet<float>(9 * t + 3 * j, ind[t][i], tet.DT[i][j]));
     }
 
+    for (int i = 0; i < nVerts; i++)
+        triplets_M.push_back(Triplet<float>(i, i, material.density * factor.lumpedMass[i]));
+
     //set matrices
-    SparseMatrix<float> K(9 * nTets, 9 * nTets);	// actually 2 * dt* dt * K
+    SparseMatrix<float> K(9 * nTets, 9 * nTets);
     SparseMatrix<float> D(9 * nTets, nVerts);
     SparseMatrix<float> M(nVerts, nVerts);
     K.setFromTriplets(triplets_K.begin(), triplets_K.end());
     D.setFromTriplets(triplets_D.begin(), triplets_D.end());
     M.setFromTriplets(triplets_M.begin(), triplets_M.end());
 
-    //compute system matrix and Cholesky factorization (Algorithm 1, line 13)
-    //remove the upper-left 3*nFixedVertices x 3*nFixedVertices block
-    SparseMatrix<float> M_plus_DT_K_D = (M + D.transpose() * K * D).block(0, 0, nVerts, nVerts);
-
-    SimplicialLLT<SparseMatrix<float>, Lower, AMDOrdering<int>> LLT;
-    LLT.compute(M_plus_DT_K_D);
-    perm = LLT.permutationP();
-    permInv = LLT.permutationPinv();
-    matL = SparseMatrix<float, ColMajor>(LLT.matrixL().cast<float>());
-    matLT = SparseMatrix<float, ColMajor>(LLT.matrixU().cast<float>());
-
-    //move data to vector registers
-    Kvec.resize(vecSize);
-    convertToNEON(Kreal, Kvec);
-    DT.resize(vecSize);
-    convertToNEON(Dt, DT);
-    //prepare solver variables
-    x_old.resize(nVerts);
-    x_old.assign(p.begin(), p.end());
-    quats.resize(vecSize);
-    for (int i = 0; i < vecSize; i++)
-        quats[i] = Quaternion4f(0, 0, 0, 1);
-    RHS.resize(nVerts);
-    RHS_perm.resize(nVerts);
+    return M + SparseMatrix<float>(D.transpose()) * K * D;
+}
 
-    //initialize volume constraints
-    for (size_t i = 0; i < invMass.size(); i++)
-        invMass[i] = 1.0 / invMass[i];
+//numeric factorizations of the system matrices of a shape for all time steps with the symbolic analysis of the shape,
+//which is done first if there is none yet. the matrices only differ in their values
+bool Physics::factorizeLadder(BodyFactor& factor, const Material& material, vector<SparseMatrix<float, ColMajor>>& L) {
+
+    L.resize(timeStepLevelCount);
+
+    for (int level = 0; level < timeStepLevelCount; level++) {
+        SparseMatrix<float> M_plus_DT_K_D = assembleSystemMatrix(factor, material, getTimeStep(level));
+
+        if (!factor.symbolicAnalysisDone) {
+            factor.LLT.analyzePattern(M_plus_DT_K_D);
+            factor.symbolicAnalysisDone = true;
+        }
+
+        factor.LLT.factorize(M_plus_DT_K_D);
+        if (factor.LLT.info() != Success)
+            return false;
+
+        L[level] = SparseMatrix<float, ColMajor>(factor.LLT.matrixL().cast<float>());
+    }
+
+    return true;
+}
+
+//fill-in reducing orderings of the batched system and of every instance group from the ones of their shapes
+void Physics::initializePermutations() {
+
+    VectorXi permutation(nBatchedVerts);
+    for (size_t b = 0; b < bodies.size(); b++) {
+        const Body& body = bodies[b];
+        if (body.group)
+            continue;
+
+        for (int i = 0; i < body.vertexCount; i++)
+            permutation[body.vertexOffset + i] = body.vertexOffset + body.factor->permutation[i];
+    }
+
+    perm.indices() = permutation;
+    permInv = perm.inverse();
+
+    for (size_t g = 0; g < instanceGroups.size(); g++) {
+        const vector<int>& shapePermutation = instanceGroups[g]->factor->permutation;
+
+        PermutationMatrix<Dynamic, Dynamic, int> shapePerm;
+        shapePerm.indices() = Map<const VectorXi>(shapePermutation.data(), shapePermutation.size());
+        instanceGroups[g]->permInv = shapePerm.inverse();
+    }
+}
+
+//block diagonal factors of the batched bodies from the factors of their shapes, one per time step
+void Physics::combineFactors(vector<SparseMatrix<float, ColMajor>>& L) {
+
+    L.resize(timeStepLevelCount);
+
+    for (int level = 0; level < timeStepLevelCount; level++) {
+        size_t nonZeros = 0;
+        for (size_t b = 0; b < bodies.size(); b++)
+            if (!bodies[b].group)
+                nonZeros += bodies[b].factor->matL[level].nonZeros();
+
+        vector<Triplet<float>> triplets;
+        triplets.reserve(nonZeros);
+
+        for (size_t b = 0; b < bodies.size(); b++) {
+            if (bodies[b].group)
+                continue;
+
+            const SparseMatrix<float, ColMajor>& block = bodies[b].factor->matL[level];
+            const int offset = bodies[b].vertexOffset;
+
+            for (int k = 0; k < block.outerSize(); k++)
+                for (SparseMatrix<float, ColMajor>::InnerIterator it(block, k); it; ++it)
+                    triplets.push_back(Triplet<float>(offset + it.row(), offset + it.col(), it.value()));
+        }
+
+        L[level].resize(nBatchedVerts, nBatchedVerts);
+        L[level].setFromTriplets(triplets.begin(), triplets.end());
+    }
+}
+
+void Physics::combineInverseMasses(vector<float>& invMass) {
+
+    invMass.resize(nBatchedVerts);
+
+    for (size_t b = 0; b < bodies.size(); b++)
+        if (!bodies[b].group)
+            std::copy(bodies[b].factor->invMass.begin(), bodies[b].factor->invMass.end(), invMass.begin() + bodies[b].vertexOffset);
+}
+
+void Physics::initializeTriangularSolvers(const vector<SparseMatrix<float, ColMajor>>& L,
+        const PermutationMatrix<Dynamic, Dynamic, int>& permInv, vector<TriangularSolver>& solvers) {
+
+    solvers.resize(L.size());
+
+    for (size_t level = 0; level < L.size(); level++) {
+        SparseMatrix<float, ColMajor> LT = L[level].transpose();
+        solvers[level].initialize(L[level], LT, permInv, workerPool.getThreadCount());
+        solvers[level].setRowKernels(kernels.solveTriangularRows, kernels.solveTriangularRowsInstanced);
+    }
+}
+
+//moves the constants of the shape of every group to its records, in the order of the constraint phases of the shape,
+//and prepares the triangular solvers of the factorizations of the shape
+void Physics::initializeInstanceGroups() {
+
+    for (size_t g = 0; g < instanceGroups.size(); g++) {
+        InstanceGroup& group = *instanceGroups[g];
+        const BodyFactor& factor = *group.factor;
+        const vector<vector<int>>& ind = factor.model->getTets();
+
+        //one tet at a time, every phase only has to consist of independent constraints
+        vector<vector<int>> phases;
+        ConstraintColoring::compute(ind, factor.model->getAllVerticesCount(), 1, phases);
+
+        group.tets.clear();
+        group.tets.reserve(ind.size());
+
+        for (size_t phase = 0; phase < phases.size(); phase++)
+            for (size_t c = 0; c < phases[phase].size(); c++) {
+                int t = phases[phase][c];
+                const TetConstants& constants = factor.tetConstants[t];
+
+                InstancedTet tet;
+                for (int j = 0; j < 4; j++) {
+                    for (int k = 0; k < 3; k++)
+                        tet.DT[j][k] = constants.DT[j][k];
+
+                    tet.invMass[j] = factor.invMass[ind[t][j]];
+                    tet.indices[j] = ind[t][j];
+                }
+                tet.K = constants.K;
+                tet.restVolume = constants.restVolume;
+                tet.alpha = constants.alpha;
+
+                group.tets.push_back(tet);
+            }
+
+        initializeTriangularSolvers(factor.matL, group.permInv, group.triangularSolvers);
+
+        group.data.tetCount = (unsigned int) group.tets.size();
+        group.data.tets = group.tets.data();
+
+        const TriangularSolver& triangularSolver = group.triangularSolvers[0];
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Instances: %d bodies of one shape share %d tets, %d phases, "
+                  "a triangular solve of %d unknowns, %d non zeros and %d levels",
+                  group.data.instanceCount, group.data.tetCount, (int) phases.size(),
+                  triangularSolver.getSize(), triangularSolver.getNonZeros(), triangularSolver.getLevelCount());
+    }
+}
+
+//resets the state of the instances for the lane width of the kernels and splits them between the threads
+void Physics::initializeInstanceState() {
+
+    const int W = kernels.laneWidth;
+
+    vector<InstanceRange> blocks;
+
+    for (size_t g = 0; g < instanceGroups.size(); g++) {
+        InstanceGroup& group = *instanceGroups[g];
+        InstanceGroupData& data = group.data;
+
+        data.instanceStride = (data.instanceCount + W - 1) / W * W;
+
+        group.quat.assign(4 * data.instanceStride * data.tetCount, 0.0f);
+        for (unsigned int t = 0; t < data.tetCount; t++)
+            std::fill(group.quat.begin() + (4 * t + 3) * data.instanceStride,
+                      group.quat.begin() + (4 * t + 4) * data.instanceStride, 1.0f);
+        group.kappa.assign(data.instanceStride * data.tetCount, 0.0f);
+
+        data.quat = group.quat.data();
+        data.kappa = group.kappa.data();
+
+        for (int i = 0; i < data.instanceCount; i += W) {
+            InstanceRange block = { (int) g, i, std::min(i + W, data.instanceCount) };
+            blocks.push_back(block);
+        }
+    }
+
+    //consecutive blocks of a group handled by the same thread form one range
+    const int threadCount = workerPool.getThreadCount();
+    threadInstanceRanges.assign(threadCount, vector<InstanceRange>());
+
+    for (int thread = 0; thread < threadCount; thread++) {
+        vector<InstanceRange>& ranges = threadInstanceRanges[thread];
+
+        int blockBegin = (int) blocks.size() * thread / threadCount;
+        int blockEnd = (int) blocks.size() * (thread + 1) / threadCount;
+
+        for (int b = blockBegin; b < blockEnd; b++)
+            if (!ranges.empty() && ranges.back().group == blocks[b].group)
+                ranges.back().instanceEnd = blocks[b].instanceEnd;
+            else
+                ranges.push_back(blocks[b]);
+    }
+
+    instanceThreadCount = 0;
+    for (int thread = 0; thread < threadCount; thread++)
+        instanceThreadCount += !threadInstanceRanges[thread].empty();
+}
+
+//the factorizations of all shapes one after another
+bool Physics::loadFactorizations(uint64_t key) {
+
+    FactorCache cache(FACTOR_CACHE_FILE_NAME);
+
+    if (!cache.load(key))
+        return false;
+
+    for (size_t f = 0; f < factors.size(); f++) {
+        BodyFactor& factor = *factors[f];
+        const unsigned int nVerts = factor.model->getAllVerticesCount();
+
+        if (!cache.get(factor.tetConstants) || !cache.get(factor.invMass) || !cache.get(factor.lumpedMass) ||
+            !cache.get(factor.permutation))
+            return false;
+
+        //the key covers the number of time steps
+        factor.matL.resize(timeStepLevelCount);
+        bool valid = factor.tetConstants.size() == factor.model->getTetCount() && factor.invMass.size() == nVerts &&
+                     factor.lumpedMass.size() == nVerts && factor.permutation.size() == nVerts;
+
+        for (int level = 0; level < timeStepLevelCount && valid; level++)
+            valid = cache.get(factor.matL[level]) && factor.matL[level].rows() == nVerts;
+
+        if (!valid)
+            return false;
+
+        //the first material change repeats the symbolic analysis
+        factor.symbolicAnalysisDone = false;
+    }
+
+    return true;
+}
+
+//L^T is not stored, it is transposed again for the triangular solvers
+void Physics::saveFactorizations(uint64_t key) {
+
+    FactorCache cache(FACTOR_CACHE_FILE_NAME);
+
+    for (size_t f = 0; f < factors.size(); f++) {
+        const BodyFactor& factor = *factors[f];
+
+        cache.put(factor.tetConstants);
+        cache.put(factor.invMass);
+        cache.put(factor.lumpedMass);
+        cache.put(factor.permutation);
+        for (size_t level = 0; level < factor.matL.size(); level++)
+            cache.put(factor.matL[level]);
+    }
+
+    cache.save(key);
+}
+
+//builds everything that depends on the lane width of the kernels: the staging area of the gather assembly,
+//the constraint phases, the batch records and the state of the instances
+void Physics::initializeBatches()
+{
+    vector<vector<int>>& ind = tets;
+    const int W = kernels.laneWidth;
+
+    vecSize = (nBatchedTets + W - 1) / W;
+
+    initializeRHSGather(ind);
+
+    //initialize volume constraints. For parallel Gauss-Seidel they are grouped with graph coloring
+    double coloringStart = getTime();
+    vector<vector<int>> phases;
+    ConstraintColoring::compute(ind, nBatchedVerts, W, phases);
+    double coloringTime = getTime() - coloringStart;
+
+    constraintBatchCount = 0;
+    string phaseHistogram;
+    for (size_t phase = 0; phase < phases.size(); phase++) {
+        constraintBatchCount += (phases[phase].size() + W - 1) / W;
+        phaseHistogram += (phase > 0 ? " " : "") + to_string(phases[phase].size());
+    }
+
+    if (nBatchedTets > 0)
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Constraint coloring: %d phases in %.1f ms, %.1f%% lanes used, phase sizes %s",
+                  (int) phases.size(), coloringTime * 1000.0, 100.0 * nBatchedTets / ((double) W * std::max(constraintBatchCount, 1u)),
+                  phaseHistogram.c_str());
+
+    switch (W) {
+        case 16:
+            initializeBatchRecords<16>(ind, phases);
+            break;
+        case 8:
+            initializeBatchRecords<8>(ind, phases);
+            break;
+        default:
+            initializeBatchRecords<4>(ind, phases);
+    }
+
+    //the records are built from the constants for dt, they have to match the factor of the current level.
+    //the records of the instances are not rebuilt and keep their scaling
+    if (timeStepLevel > 0) {
+        double ratio = getTimeStep(timeStepLevel) / dt;
+        scaleBatchRecords((float) (ratio * ratio), (float) (1.0 / (ratio * ratio)), 1.0f);
+    }
+
+    kernelData.x = positions.x.data();
+    kernelData.y = positions.y.data();
+    kernelData.z = positions.z.data();
+    kernelData.tetCount = nBatchedTets;
+    kernelData.staging = (float*) RHS_staging.data();
+    kernelData.phaseBatchOffsets = phaseBatchOffsets.data();
+    kernelData.phaseSizes = phaseSizes.data();
+
+    initializeInstanceState();
 
-    initializeVolumeConstraints(ind, rest_volume, invMass, lambda);
+    logMemoryFootprint();
 }
 
-//initializes the volume constraints. For parallel Gauss-Seidel they are grouped with graph coloring
-//the inverse masses, alpha values and rest volumes are moved to vector registers
-void Physics::initializeVolumeConstraints(const vector<vector<int>> &ind, vector<float> &rest_volume,
-        vector<float> &invMass, float lambda)
+//allocates the batch records of lane width W and moves the constants to them
+template <int W>
+void Physics::initializeBatchRecords(const vector<vector<int>> &ind, const vector<vector<int>> &phases)
 {
-    constraintGraphColoring(ind, nVerts, volume_constraint_phases);
+    tetBatchSize = sizeof(TetBatch<W>);
+    constraintBatchSize = sizeof(ConstraintBatch<W>);
 
-    inv_mass_phases.resize(volume_constraint_phases.size());
-    rest_volume_phases.resize(volume_constraint_phases.size());
-    kappa_phases.resize(volume_constraint_phases.size());
-    alpha_phases.resize(volume_constraint_phases.size());
+    arena.initialize(Arena::align(vecSize * tetBatchSize) + Arena::align(constraintBatchCount * constraintBatchSize) +
+                     Arena::align(vecSize * constraintBatchSize));
 
-    for (int phase = 0; phase < volume_constraint_phases.size(); phase++)	//forall constraint phases
+    TetBatch<W>* tetBatches = arena.allocate<TetBatch<W>>(vecSize);
+    ConstraintBatch<W>* constraintBatches = arena.allocate<ConstraintBatch<W>>(constraintBatchCount);
+    ConstraintBatch<W>* jacobiBatches = arena.allocate<ConstraintBatch<W>>(vecSize);
+
+    initializeTetBatches(tetBatches, ind);
+    initializeVolumeConstraints(constraintBatches, jacobiBatches, ind, phases);
+
+    kernelData.tetBatches = tetBatches;
+    kernelData.constraintBatches = constraintBatches;
+    kernelData.jacobiBatches = jacobiBatches;
+}
+
+//moves the constants of the local step to the batch records
+template <int W>
+void Physics::initializeTetBatches(TetBatch<W>* batches, const vector<vector<int>> &ind)
+{
+    for (int i = 0; i < vecSize; i++)
     {
-        inv_mass_phases[phase].resize(0);
-        rest_volume_phases[phase].resize(0);
-        kappa_phases[phase].resize(0);
-        alpha_phases[phase].resize(0);
-        for (int c = 0; c<volume_constraint_phases[phase].size(); c += 4)	//forall constraints in phase
+        TetBatch<W>& batch = batches[i];
+
+        for (int lane = 0; lane < W; lane++)
         {
-            int c4[4];
-            for (int k = 0; k < 4; k++)
-                if (c + k < volume_constraint_phases[phase].size())
-                    c4[k] = volume_constraint_phases[phase][c + k];
-
-            float w0[4], w1[4], w2[4], w3[4], vol[4], alpha[4];
-            for (int k = 0; k < 4; k++)
-                if (c + k < volume_constraint_phases[phase].size())
-                {
-                    w0[k] = (float)invMass[ind[c4[k]][0]];
-                    w1[k] = (float)invMass[ind[c4[k]][1]];
-                    w2[k] = (float)invMass[ind[c4[k]][2]];
-                    w3[k] = (float)invMass[ind[c4[k]][3]];
-
-                    vol[k] = (float)rest_volume[c4[k]];
-                    alpha[k] = 1.0f / (float)(lambda * rest_volume[c4[k]] * dt * dt);
-                }
-                else
-                {
-                    vol[k] = 1.0f;
-                    alpha[k] = 0.0f;
-                    w0[k] = (float)invMass[ind[c4[k]][0]];
-                    w1[k] = (float)invMass[ind[c4[k]][1]];
-                    w2[k] = (float)invMass[ind[c4[k]][2]];
-                    w3[k] = (float)invMass[ind[c4[k]][3]];
-                }
+            int t = std::min(W * i + lane, (int) nBatchedTets - 1);	//padding with the last tet (they are never read out)
+            const TetConstants& tet = tetConstants[t];
+
+            for (int j = 0; j < 4; j++)
+            {
+                for (int k = 0; k < 3; k++)
+                    batch.DT[j][k][lane] = tet.DT[j][k];
 
-            int pos = (int)inv_mass_phases[phase].size();
-            inv_mass_phases[phase].push_back(vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>(4));
+                batch.indices[j][lane] = ind[t][j];
+            }
 
-            inv_mass_phases[phase][pos][0].load(w0);
-            inv_mass_phases[phase][pos][1].load(w1);
-            inv_mass_phases[phase][pos][2].load(w2);
-            inv_mass_phases[phase][pos][3].load(w3);
+            batch.K[lane] = tet.K;
 
-            Scalarf4 restVol, alpha4;
-            restVol.load(vol);
-            alpha4.load(alpha);
-            rest_volume_phases[phase].push_back(restVol);
-            kappa_phases[phase].push_back(Scalarf4(0.0f));
-            alpha_phases[phase].push_back(alpha4);
+            batch.quat[0][lane] = 0.0f;
+            batch.quat[1][lane] = 0.0f;
+            batch.quat[2][lane] = 0.0f;
+            batch.quat[3][lane] = 1.0f;
         }
     }
 }
 
-// this method is taken from the PBD library: https://github.com/InteractiveComputerGraphics/PositionBasedDynamics
-void Physics::constraintGraphColoring(const vector<vector<int>>& particleIndices, int n,
-        vector<vector<int>>& coloring)
+//builds the CSR map from every vertex to the staging entries of the corners it belongs to.
+//entry (4 * i + k) * W + j holds the result of corner k of tet W * i + j, padding lanes are never referenced
+void Physics::initializeRHSGather(const vector<vector<int>> &ind)
 {
-    //particleIndices [constraint][particleIndex]
-    vector<vector<bool>> particleColors;   //numColors x numParticles, true if particle in color
-    particleColors.resize(0);
-    coloring.resize(0);
+    const int W = kernels.laneWidth;
 
-    for (unsigned int i = 0; i < particleIndices.size(); i++)   //forall constraints
-    {
-        bool newColor = true;
-        for (unsigned int j = 0; j < coloring.size(); j++)  //forall colors
-        {
-            bool addToThisColor = true;
+    RHS_staging.resize(vecSize * 4 * W);
 
-            for (unsigned int k = 0; k < particleIndices[i].size(); k++) { //forall particles innvolved in the constraint
-                if (particleColors[j][particleIndices[i][k]] == true) {
-                    addToThisColor = false;
-                    break;
-                }
-            }
-            if (addToThisColor) {
-                coloring[j].push_back(i);
+    RHS_gather_offsets.assign(nBatchedVerts + 1, 0);
+    for (int t = 0; t < nBatchedTets; t++)
+        for (int k = 0; k < 4; k++)
+            RHS_gather_offsets[ind[t][k] + 1]++;
 
-                for (unsigned int k = 0; k < particleIndices[i].size(); k++) //forall particles innvolved in the constraint
-                    particleColors[j][particleIndices[i][k]] = true;
+    for (int i = 0; i < nBatchedVerts; i++)
+        RHS_gather_offsets[i + 1] += RHS_gather_offsets[i];
 
-                newColor = false;
-                break;
-            }
-        }
-        if (newColor) {
-            particleColors.push_back(vector<bool>(n, false));
-            coloring.resize(coloring.size() + 1);
-            coloring[coloring.size() - 1].push_back(i);
-            for (unsigned int k = 0; k < particleIndices[i].size(); k++) //forall particles innvolved in the constraint
-                particleColors[coloring.size() - 1][particleIndices[i][k]] = true;
-        }
-    }
+    vector<int> fill(RHS_gather_offsets.begin(), RHS_gather_offsets.end() - 1);
+    RHS_gather_slots.resize(nBatchedTets * 4);
+    for (int t = 0; t < nBatchedTets; t++)
+        for (int k = 0; k < 4; k++)
+            RHS_gather_slots[fill[ind[t][k]]++] = (4 * (t / W) + k) * W + t % W;
 }
 
-void Physics::convertToNEON(const vector<float>& v, vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>& vNEON)
+//moves the volume constraints to the batch records phase by phase
+template <int W>
+void Physics::initializeVolumeConstraints(ConstraintBatch<W>* batches, ConstraintBatch<W>* jacobi,
+        const vector<vector<int>> &ind, const vector<vector<int>> &phases)
 {
-    int regularPart = (nTets / 4) * 4;
-    for (int i = 0; i < regularPart; i += 4)
-        vNEON[i / 4] = Scalarf4(v[i + 0], v[i + 1], v[i + 2], v[i + 3]);
+    phaseBatchOffsets.resize(phases.size() + 1);
+    phaseSizes.resize(phases.size());
+    phaseThreads.resize(phases.size());
+
+    int b = 0;
+    for (int phase = 0; phase < phases.size(); phase++)	//forall constraint phases
+    {
+        phaseBatchOffsets[phase] = b;
+        phaseSizes[phase] = (int) phases[phase].size();
+
+        int phaseBatchCount = (phaseSizes[phase] + W - 1) / W;
+        phaseThreads[phase] = std::min(workerPool.getThreadCount(), std::max(1, phaseBatchCount / MIN_CONSTRAINT_BATCHES_PER_THREAD));
 
-    if (regularPart != nTets)	//add padding with last value of v. (they are never read out)
-        for (int j = 0; j < 3; j++)
+        for (int c = 0; c < phases[phase].size(); c += W, b++)	//forall constraints in phase
         {
-            float vtmp[4];
-            for (int i = regularPart; i < regularPart + 4; i++)
-                if (i < nTets) vtmp[i - regularPart] = v[i];
-                else vtmp[i - regularPart] = v[nTets - 1];
+            int lanes = std::min(W, phaseSizes[phase] - c);
 
-            vNEON[regularPart / 4] = Scalarf4(vtmp[0], vtmp[1], vtmp[2], vtmp[3]);
+            int tets[W];	//padding lanes repeat the first tet and are never written back
+            for (int k = 0; k < W; k++)
+                tets[k] = phases[phase][c + std::min(k, lanes - 1)];
+
+            initializeConstraintBatch(batches[b], tets, lanes, ind);
         }
+    }
+
+    phaseBatchOffsets[phases.size()] = b;
+
+    //Jacobi mode, padding lanes repeat the last tet like the batches of the local step
+    for (int i = 0; i < vecSize; i++)
+    {
+        int lanes = std::min(W, (int) nBatchedTets - W * i);
+
+        int tets[W];
+        for (int k = 0; k < W; k++)
+            tets[k] = W * i + std::min(k, lanes - 1);
+
+        initializeConstraintBatch(jacobi[i], tets, lanes, ind);
+    }
 }
 
-void Physics::convertToNEON(const vector<vector<vector<float>>>& v,
-        vector<vector<vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>>>& vNEON)
+//lanes [lanes, W) of the batch are padding
+template <int W>
+void Physics::initializeConstraintBatch(ConstraintBatch<W> &batch, const int* tets, int lanes, const vector<vector<int>> &ind)
 {
-    int regularPart = (nTets / 4) * 4;
-    for (int i = 0; i < regularPart; i += 4)
+    for (int k = 0; k < W; k++)
     {
-        vNEON[i / 4].resize(4);
+        const TetConstants& tet = tetConstants[tets[k]];
+
         for (int j = 0; j < 4; j++)
         {
-            vNEON[i / 4][j].resize(3);
-            for (int k = 0; k < 3; k++)
-                vNEON[i / 4][j][k] = Scalarf4(v[i + 0][j][k], v[i + 1][j][k], v[i + 2][j][k], v[i + 3][j][k]);
+            batch.invMass[j][k] = invMass[ind[tets[k]][j]];
+            batch.indices[j][k] = ind[tets[k]][j];
         }
+
+        batch.restVolume[k] = k < lanes ? tet.restVolume : 1.0f;
+        batch.alpha[k] = k < lanes ? tet.alpha : 0.0f;
+        batch.kappa[k] = 0.0f;
     }
+}
 
-    if (regularPart != nTets) {	//add padding with last value of v. (they are never read out)
-        vNEON[regularPart / 4].resize(4);
-        for (int j = 0; j < 4; j++)
-        {
-            vNEON[regularPart / 4][j].resize(3);
-            for (int k = 0; k < 3; k++)
-            {
-                float vtmp[4];
-                for (int i = regularPart; i < regularPart + 4; i++)
-                    if (i < nTets) vtmp[i - regularPart] = v[i][j][k];
-                    else vtmp[i - regularPart] = v[nTets - 1][j][k];
+//resets the Lagrange multipliers of the constraint batches at the start of a substep
+template <int W>
+static void resetBatchMultipliers(ConstraintBatch<W>* batches, int count)
+{
+    for (int i = 0; i < count; i++)
+        for (int k = 0; k < W; k++)
+            batches[i].kappa[k] = 0.0f;
+}
 
-                vNEON[regularPart / 4][j][k] = Scalarf4(vtmp[0], vtmp[1], vtmp[2], vtmp[3]);
-            }
-        }
+void Physics::resetMultipliers(void* batches, int count)
+{
+    switch (kernels.laneWidth) {
+        case 16:
+            resetBatchMultipliers((ConstraintBatch<16>*) batches, count);
+            break;
+        case 8:
+            resetBatchMultipliers((ConstraintBatch<8>*) batches, count);
+            break;
+        default:
+            resetBatchMultipliers((ConstraintBatch<4>*) batches, count);
+    }
+}
+
+void Physics::logMemoryFootprint()
+{
+    const double KB = 1.0 / 1024.0;
+
+    size_t positionsSize = 6 * nVertsPadded * sizeof(float);
+    size_t triangularSolverSize = 0;
+    for (size_t i = 0; i < triangularSolvers.size(); i++)
+        triangularSolverSize += triangularSolvers[i].getMemoryFootprint();
+    size_t rhsSize = (RHS.size() + threadRHS.size() * nBatchedVerts + RHS_staging.size()) * sizeof(Scalarf4) +
+                     (RHS_gather_offsets.size() + RHS_gather_slots.size()) * sizeof(int);
+
+    if (nBatchedTets > 0) {
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG,
+                  "Memory: batches %.1f KB (%d tet batches of %d B, %d constraint batches of %d B), "
+                  "positions %.1f KB, RHS %.1f KB, triangular solve %.1f KB",
+                  arena.getUsed() * KB, vecSize, (int) tetBatchSize, constraintBatchCount, (int) constraintBatchSize,
+                  positionsSize * KB, rhsSize * KB, triangularSolverSize * KB);
+    } else {
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Memory: positions %.1f KB, RHS %.1f KB",
+                  positionsSize * KB, rhsSize * KB);
+    }
+
+    //an instance adds its positions, its RHS entries and the rotations and multipliers of its tets
+    for (size_t g = 0; g < instanceGroups.size(); g++) {
+        const InstanceGroup& group = *instanceGroups[g];
+
+        size_t sharedSize = group.tets.size() * sizeof(InstancedTet);
+        for (size_t i = 0; i < group.triangularSolvers.size(); i++)
+            sharedSize += group.triangularSolvers[i].getMemoryFootprint();
+        size_t instanceSize = group.factor->model->getAllVerticesCount() * (6 * sizeof(float) + sizeof(Scalarf4)) +
+                              group.tets.size() * 5 * sizeof(float);
+
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Memory: %d instances, %.1f KB shared, %.1f KB per instance",
+                  group.data.instanceCount, sharedSize * KB, instanceSize * KB);
     }
 }
 
@@ -351,6 +1199,9 @@ void Physics::finalize() {
     if (this->initialized == 0)
         return;
 
+    pthread_check_error(pthread_join(initThread, nullptr));
+    stopMaterialThread();
+
     saveSimulationState();
 
     if (walls) {
@@ -358,23 +1209,41 @@ void Physics::finalize() {
         walls = nullptr;
     }
 
-    if (model) {
-        delete model;
-        model = nullptr;
-    }
+    for (size_t b = 0; b < bodies.size(); b++)
+        delete bodies[b].model;
+    bodies.clear();
 
-    x_old.clear();
-    RHS.clear();
-    RHS_perm.clear();
-    Kvec.clear();
-    DT.clear();
-    quats.clear();
-    volume_constraint_phases.clear();
-    rest_volume_phases.clear();
-    alpha_phases.clear();
-    kappa_phases.clear();
-    inv_mass_phases.clear();
+    for (size_t f = 0; f < factors.size(); f++)
+        delete factors[f];
+    factors.clear();
+
+    for (size_t g = 0; g < instanceGroups.size(); g++)
+        delete instanceGroups[g];
+    instanceGroups.clear();
+    threadInstanceRanges.clear();
 
+    tets.clear();
+    positions.clear();
+    positions_old.clear();
+    RHS.clear();
+    threadRHS.clear();
+    RHS_staging.clear();
+    RHS_gather_offsets.clear();
+    RHS_gather_slots.clear();
+    tetConstants.clear();
+    invMass.clear();
+    triangularSolvers.clear();
+    matL.clear();
+    arena.finalize();
+    constraintBatchCount = 0;
+    kernelData = KernelData();
+    phaseBatchOffsets.clear();
+    phaseSizes.clear();
+    phaseThreads.clear();
+
+    workerPool.finalize();
+
+    solverReady = false;
     this->initialized = 0;
 }
 
@@ -398,6 +1267,10 @@ void* Physics::thread_entrypoint(void* opaque) {
 
 void Physics::threadLoop() {
 
+    //the time spent waiting for the solver is not simulated
+    while (started && !isSolverReady())
+        usleep((useconds_t)(dt * 1000 * 1000));
+
     double t = 0.0;
     double lastAdvanceTime = getTime();
 
@@ -406,355 +1279,661 @@ void Physics::threadLoop() {
         t += now - lastAdvanceTime;
         lastAdvanceTime = now;
 
-        if (t >= dt) {
+        if (t >= stepDt) {
+            //only if even the largest time step can't keep up
             if (t > dt * MAX_STEPS_LAG) {
-                print_log(ANDROID_LOG_WARN, PHYSICS_TAG, "Lagging %d steps", (int) (t / dt));
+                print_log(ANDROID_LOG_WARN, PHYSICS_TAG, "Lagging %d steps", (int) (t / stepDt));
                 t = 0.0;
             }
 
-            while (t >= dt) {
-                t -= dt;
+            while (t >= stepDt) {
+                t -= stepDt;
+                applyMaterialUpdate();
+
+                double substepStart = getTime();
                 subStep();
+
+                if (timeStepLevelCount > 1)
+                    updateTimeStepLevel(getTime() - substepStart);
             }
         } else
             // sleep just for a very little while
-            usleep((useconds_t)(dt * 1000 * 1000 / 10));
+            usleep((useconds_t)(stepDt * 1000 * 1000 / 10));
     }
 }
 
-// iterations
+void Physics::step(int substeps) {
 
-void Physics::subStep() {
+    while (!isSolverReady())
+        usleep(1000);
 
-    vector<EigenVector3>& x = model->getAllVertices();
-    vector<vector<int>>& ind = model->getTets();
+    for (int s = 0; s < substeps; s++) {
+        applyMaterialUpdate();
+        subStep();
+    }
+}
 
-    //explicit Euler to compute \tilde{x}
-    for (int i = 0; i < nVerts; i++)
-    {
-        EigenVector3 v = (x[i] - x_old[i]) / dt;
+double Physics::getCurrentTimeStep() const {
+    return stepDt;
+}
+
+const SubstepTimings& Physics::getSubstepTimings() const {
+    return timings;
+}
 
-        v += (dt * gravity);	//gravity
+void Physics::resetSubstepTimings() {
+    timings = SubstepTimings();
+}
+
+// material
+
+void Physics::setMaterial(const Material& material) {
+
+    pthread_mutex_lock(&materialMutex);
 
-        processCollision(x[i], v);
+    requestedMaterial = material;
+    materialRequested = true;
 
-        x_old[i] = x[i];
-        x[i] += dt * v;
+    if (!materialThreadRunning) {
+        //the previous material thread has already left its loop
+        if (materialThreadJoinable)
+            pthread_check_error(pthread_join(materialThread, nullptr));
+
+        materialThreadRunning = true;
+        materialThreadJoinable = true;
+        materialThreadStopping = false;
+        pthread_check_error(pthread_create(&materialThread, nullptr, material_thread_entrypoint, nullptr));
     }
 
-    solveOptimizationProblem(x, ind);
+    pthread_mutex_unlock(&materialMutex);
+}
+
+void* Physics::material_thread_entrypoint(void* opaque) {
 
-    //solve volume constraints
-    for (size_t i = 0; i < kappa_phases.size(); i++)	//reset Lagrange multipliers
-        for (size_t j = 0; j < kappa_phases[i].size(); j++)
-            kappa_phases[i][j] = Scalarf4(0.0f);
+    Physics::getInstance().materialThreadLoop();
+    return nullptr;
+}
+
+//prepares the requested materials one after another. an update that was not swapped in yet
+//is replaced by the newer one
+void Physics::materialThreadLoop() {
+
+    while (!isSolverReady())
+        usleep((useconds_t)(dt * 1000 * 1000));
+
+    while (true) {
+        pthread_mutex_lock(&materialMutex);
+        if (!materialRequested || materialThreadStopping) {
+            materialThreadRunning = false;
+            pthread_mutex_unlock(&materialMutex);
+            break;
+        }
+        Material material = requestedMaterial;
+        materialRequested = false;
+        pthread_mutex_unlock(&materialMutex);
+
+        double startTime = getTime();
+        MaterialUpdate* update = prepareMaterialUpdate(material);
+        if (!update)
+            continue;
+
+        delete pendingMaterialUpdate.exchange(update);
 
-    for (int it = 0; it < 2; it++)	//solve constraints
-        solveVolumeConstraints(x, ind);
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Material (density %.1f, E %.0f, nu %.3f) refactorized in %.1f ms",
+                  material.density, material.youngsModulus, material.poissonRatio, (getTime() - startTime) * 1000.0);
+    }
+}
+
+void Physics::stopMaterialThread() {
+
+    pthread_mutex_lock(&materialMutex);
+    materialThreadStopping = true;
+    bool joinable = materialThreadJoinable;
+    materialThreadJoinable = false;
+    pthread_mutex_unlock(&materialMutex);
 
-    model->invalidate();
+    if (joinable)
+        pthread_check_error(pthread_join(materialThread, nullptr));
+
+    delete pendingMaterialUpdate.exchange(nullptr);
 }
 
-void Physics::processCollision(EigenVector3& position, EigenVector3& velocity) {
+//numeric factorizations of the system matrices of every shape for the material with the symbolic analyses
+//of the initialization, the inverse masses and the triangular solvers of all bodies for them
+Physics::MaterialUpdate* Physics::prepareMaterialUpdate(const Material& material) {
+
+    vector<vector<SparseMatrix<float, ColMajor>>> factorL(factors.size());
+
+    for (size_t f = 0; f < factors.size(); f++)
+        if (!factorizeLadder(*factors[f], material, factorL[f])) {
+            print_log(ANDROID_LOG_WARN, PHYSICS_TAG, "Material (density %.1f, E %.0f, nu %.3f) gives no positive definite system",
+                      material.density, material.youngsModulus, material.poissonRatio);
+            return nullptr;
+        }
+
+    //the factors of the shapes are only combined here, the physics thread does not use them.
+    //factors loaded from the cache were ordered by the symbolic analysis of an earlier run, if the one repeated
+    //by this update orders a shape differently, the new factors only fit the new ordering. the permutations and
+    //with them the schedules and rows of all triangular solvers are then rebuilt for it
+    bool reordered = false;
+    for (size_t f = 0; f < factors.size(); f++) {
+        BodyFactor& factor = *factors[f];
+        const VectorXi& permutation = factor.LLT.permutationP().indices();
+
+        if (factor.permutation.size() != (size_t) permutation.size() ||
+            !std::equal(factor.permutation.begin(), factor.permutation.end(), permutation.data())) {
+            factor.permutation.assign(permutation.data(), permutation.data() + permutation.size());
+            reordered = true;
+        }
+
+        factor.matL.swap(factorL[f]);
+        computeInverseMasses(factor, material, factor.invMass);
+    }
 
-    EigenVector3 low = wallsPosition - EigenVector3(wallsSize, wallsSize, wallsSize) * 0.5f;
-    EigenVector3 high = wallsPosition + EigenVector3(wallsSize, wallsSize, wallsSize) * 0.5f;
+    if (reordered) {
+        print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Material: the symbolic analysis changed the ordering of the cached factors");
+        initializePermutations();
+    }
 
-    EigenVector3 error = EigenVector3(0, 0, 0);
+    MaterialUpdate* update = new MaterialUpdate();
+    update->material = material;
 
-    EigenVector3 delta;
+    combineFactors(update->matL);
+    initializeTriangularSolvers(update->matL, permInv, update->triangularSolvers);
+    combineInverseMasses(update->invMass);
 
-    delta = position - low;
-    error.x() = std::min(delta.x(), error.x());
-    error.y() = std::min(delta.y(), error.y());
-    error.z() = std::min(delta.z(), error.z());
+    update->groupSolvers.resize(instanceGroups.size());
+    for (size_t g = 0; g < instanceGroups.size(); g++)
+        initializeTriangularSolvers(instanceGroups[g]->factor->matL, instanceGroups[g]->permInv, update->groupSolvers[g]);
 
-    delta = position - high;
-    error.x() = std::max(delta.x(), error.x());
-    error.y() = std::max(delta.y(), error.y());
-    error.z() = std::max(delta.z(), error.z());
+    return update;
+}
 
-    const float epsilon = 10e-7;
+//swaps in the material prepared by the material thread, if there is one. runs on the physics thread between two substeps.
+//K, alpha and the inverse masses of the batch records are scaled, all of them are proportional to a material parameter
+void Physics::applyMaterialUpdate() {
 
-    if (fabs(error.x()) < epsilon && fabs(error.y()) < epsilon && fabs(error.z()) < epsilon)
+    if (!pendingMaterialUpdate.load(memory_order_relaxed))
         return;
 
-    EigenVector3 normal = -error;
-    normal.normalize();
+    MaterialUpdate* update = pendingMaterialUpdate.exchange(nullptr);
+    if (!update)
+        return;
 
-    EigenVector3 normalVelocity = normal * velocity.dot(normal);
+    const Material& next = update->material;
+    float kScale = next.getMu() / material.getMu();
+    float alphaScale = material.getLambda() / next.getLambda();
+    float invMassScale = material.density / next.density;
 
-    EigenVector3 tangentVelocity = velocity - normalVelocity;
+    material = next;
 
-    const float friction = 1.0;
+    float mu = material.getMu();
+    float lambda = material.getLambda();
+    for (int t = 0; t < nBatchedTets; t++) {
+        TetConstants& tet = tetConstants[t];
+        tet.K = 2.0 * dt * dt * mu * tet.restVolume;
+        tet.alpha = 1.0f / (float)(lambda * tet.restVolume * dt * dt);
+    }
 
-    tangentVelocity -= tangentVelocity * friction;
+    invMass.swap(update->invMass);
+    matL.swap(update->matL);
+    triangularSolvers.swap(update->triangularSolvers);
+    for (size_t g = 0; g < instanceGroups.size(); g++)
+        instanceGroups[g]->triangularSolvers.swap(update->groupSolvers[g]);
 
-    normalVelocity = 500.0f * dt * normal;
+    scaleConstants(kScale, alphaScale, invMassScale);
 
-    velocity = tangentVelocity + normalVelocity;
+    delete update;
 }
 
-void Physics::solveOptimizationProblem(vector<EigenVector3> &p, const vector<vector<int>> &ind)
+void Physics::scaleConstants(float kScale, float alphaScale, float invMassScale)
 {
-    //compute RHS of Equation (12)
-    for (size_t i = 0; i < RHS.size(); i++)
-        RHS[i] = Scalarf4(0.0f);
+    scaleBatchRecords(kScale, alphaScale, invMassScale);
 
-    for (int i = 0; i < vecSize; i++)
-    {
-        Vector3f4 F1, F2, F3;	//columns of the deformation gradient
-        computeDeformationGradient(p, ind, i, F1, F2, F3);
-
-        Quaternion4f& q = quats[i];
-        APD_Newton_NEON(F1, F2, F3, q);
-
-        //transform quaternion to rotation matrix
-        Vector3f4 R1, R2, R3;	//columns of the rotation matrix
-        quats[i].toRotationMatrix(R1, R2, R3);
-
-        // R <- R - F
-        R1 -= F1;
-        R2 -= F2;
-        R3 -= F3;
-
-        //multiply with 2 * dt * dt * DT * K from left
-        Vector3f4 dx[4];
-        dx[0] = (R1 * DT[i][0][0] + R2 * DT[i][0][1] + R3 * DT[i][0][2]) * Kvec[i];
-        dx[1] = (R1 * DT[i][1][0] + R2 * DT[i][1][1] + R3 * DT[i][1][2]) * Kvec[i];
-        dx[2] = (R1 * DT[i][2][0] + R2 * DT[i][2][1] + R3 * DT[i][2][2]) * Kvec[i];
-        dx[3] = (R1 * DT[i][3][0] + R2 * DT[i][3][1] + R3 * DT[i][3][2]) * Kvec[i];
-
-        //write results to the corresponding positions in the RHS vector
-        for(int k = 0; k < 4; k++)
+    for (size_t g = 0; g < instanceGroups.size(); g++)
+        for (size_t t = 0; t < instanceGroups[g]->tets.size(); t++)
         {
-            float x[4], y[4], z[4];
-            dx[k].x().store(x);
-            dx[k].y().store(y);
-            dx[k].z().store(z);
-
+            InstancedTet& tet = instanceGroups[g]->tets[t];
             for (int j = 0; j < 4; j++)
+                tet.invMass[j] *= invMassScale;
+            tet.K *= kScale;
+            tet.alpha *= alphaScale;
+        }
+}
+
+void Physics::scaleBatchRecords(float kScale, float alphaScale, float invMassScale)
+{
+    switch (kernels.laneWidth) {
+        case 16:
+            scaleBatchConstants<16>(kScale, alphaScale, invMassScale);
+            break;
+        case 8:
+            scaleBatchConstants<8>(kScale, alphaScale, invMassScale);
+            break;
+        default:
+            scaleBatchConstants<4>(kScale, alphaScale, invMassScale);
+    }
+}
+
+template <int W>
+void Physics::scaleBatchConstants(float kScale, float alphaScale, float invMassScale)
+{
+    TetBatch<W>* tetBatches = (TetBatch<W>*) kernelData.tetBatches;
+    for (int i = 0; i < vecSize; i++)
+        for (int k = 0; k < W; k++)
+            tetBatches[i].K[k] *= kScale;
+
+    ConstraintBatch<W>* constraintBatches[2] = { (ConstraintBatch<W>*) kernelData.constraintBatches,
+                                                 (ConstraintBatch<W>*) kernelData.jacobiBatches };
+    int counts[2] = { (int) constraintBatchCount, (int) vecSize };
+
+    for (int b = 0; b < 2; b++)
+        for (int i = 0; i < counts[b]; i++)
+        {
+            ConstraintBatch<W>& batch = constraintBatches[b][i];
+            for (int k = 0; k < W; k++)
             {
-                if(4 * i + j >= nTets) break;
-                int pi = ind[4 * i + j][k];
-                RHS[pi] += Scalarf4(x[j], y[j], z[j], 0.0);	//only first 3 comps are used, maybe use 128 bit registers
+                for (int j = 0; j < 4; j++)
+                    batch.invMass[j][k] *= invMassScale;
+                batch.alpha[k] *= alphaScale;
             }
         }
+}
+
+// time step ladder
+
+double Physics::getTimeStep(int level) const {
+    return dt * (1 << level);
+}
+
+//moves to another factorization between two substeps. K scales with the square of the time step and alpha
+//with its inverse, the previous positions are moved so the velocities stay the same
+void Physics::setTimeStepLevel(int level) {
+
+    double ratio = getTimeStep(level) / stepDt;
+    const Scalarf4 ratio4 = Scalarf4((float) ratio);
+
+    for (int i = 0; i < nVertsPadded; i += 4)
+    {
+        Vector3f4 x = positions.load(i);
+        positions_old.store(i, x - (x - positions_old.load(i)) * ratio4);
     }
 
-    //solve the linear system
-    //permutation of the RHS because of Eigen's fill-in reduction
-    for (size_t i = 0; i < RHS.size(); i++)
-        RHS_perm[perm.indices()[i]] = RHS[i];
+    scaleConstants((float) (ratio * ratio), (float) (1.0 / (ratio * ratio)), 1.0f);
 
-    //foreward substitution
-    for (int k = 0; k<matL.outerSize(); ++k)
-        for (SparseMatrix<float, ColMajor>::InnerIterator it(matL, k); it; ++it)
-            if (it.row() == it.col())
-                RHS_perm[it.row()] = RHS_perm[it.row()] * Scalarf4(1.0 / it.value());
-            else
-                RHS_perm[it.row()] -= Scalarf4(it.value()) * RHS_perm[it.col()];
+    timeStepLevel = level;
+    stepDt = getTimeStep(level);
+}
 
-    //backward substitution
-    for (int k = matLT.outerSize() - 1; k >= 0 ; --k)
-        for (SparseMatrix<float, ColMajor>::ReverseInnerIterator it(matLT, k); it; --it)
-            if (it.row() == it.col())
-                RHS_perm[it.row()] = RHS_perm[it.row()] * Scalarf4(1.0 / it.value());
-            else
-                RHS_perm[it.row()] -= Scalarf4(it.value()) * RHS_perm[it.col()];
+//takes the smallest time step a substep is sufficiently faster than, one level at a time
+void Physics::updateTimeStepLevel(double elapsed) {
+
+    substepTime = substepTime > 0.0 ? 0.95 * substepTime + 0.05 * elapsed : elapsed;
+
+    int level = timeStepLevel;
+    if (level + 1 < timeStepLevelCount && substepTime > getTimeStep(level) * TIME_STEP_UP_LOAD)
+        level++;
+    else if (level > 0 && substepTime < getTimeStep(level - 1) * TIME_STEP_DOWN_LOAD)
+        level--;
+
+    if (level == timeStepLevel)
+        return;
+
+    print_log(ANDROID_LOG_INFO, PHYSICS_TAG, "Time step %.1f -> %.1f ms, %.1f us per substep",
+              stepDt * 1000.0, getTimeStep(level) * 1000.0, substepTime * 1.0e6);
+
+    setTimeStepLevel(level);
+}
+
+// iterations
+
+void Physics::subStep() {
+
+    const Scalarf4 dt4 = Scalarf4((float) stepDt);
+    const Scalarf4 invDt4 = Scalarf4((float) (1.0 / stepDt));
+    const EigenVector3 gravityStep = gravity * (float) stepDt;
+    const Vector3f4 gravity4 = Vector3f4(Scalarf4(gravityStep.x()), Scalarf4(gravityStep.y()), Scalarf4(gravityStep.z()));
 
-    //invert permutation
-    for (size_t i = 0; i < RHS.size(); i++)
-        RHS[permInv.indices()[i]] = RHS_perm[i];
+    double phaseStart = getTime();
 
-    for (size_t i = 0; i<RHS.size(); i++)	// add result (delta_x) to the positions
+    //explicit Euler to compute \tilde{x}, 4 vertices at a time. the padding vertices are never read out
+    for (int i = 0; i < nVertsPadded; i += 4)
     {
-        float x[4];
-        RHS[i].store(x);
-        p[i].x() += x[0];
-        p[i].y() += x[1];
-        p[i].z() += x[2];
+        Vector3f4 x = positions.load(i);
+
+        Vector3f4 v = (x - positions_old.load(i)) * invDt4;
+
+        v += gravity4;	//gravity
+
+        processCollision(x, v);
+
+        positions_old.store(i, x);
+        positions.store(i, multiplyAdd(x, v, dt4));
+    }
+
+    double now = getTime();
+    timings.integration += now - phaseStart;
+
+    solveOptimizationProblem(positions);
+
+    phaseStart = getTime();
+
+    //solve volume constraints
+    if (config.volumeConstraints == JacobiConstraints) {
+        resetMultipliers(kernelData.jacobiBatches, vecSize);
+
+        solveVolumeConstraintsJacobi(positions, VOLUME_CONSTRAINT_ITERATIONS);
+    } else {
+        resetMultipliers(kernelData.constraintBatches, constraintBatchCount);
+
+        solveVolumeConstraints(positions, VOLUME_CONSTRAINT_ITERATIONS);
+    }
+
+    //the instances keep Gauss-Seidel if the mode is switched to Jacobi after initialize
+    solveInstancedConstraints(VOLUME_CONSTRAINT_ITERATIONS);
+
+    now = getTime();
+    timings.volumeConstraints += now - phaseStart;
+
+    publishPositions();
+
+    timings.publish += getTime() - now;
+    timings.substeps++;
+}
+
+//copies the positions to the model. skipped while the renderer has not taken the previous positions yet,
+//as they would be overwritten anyway
+void Physics::publishPositions() {
+
+    for (size_t b = 0; b < bodies.size(); b++) {
+        Body& body = bodies[b];
+
+        if (!body.model->isSyncedWithGPU())
+            continue;
+
+        vector<EigenVector3>& x = body.model->getAllVertices();
+
+        for (int i = 0; i < body.vertexCount; i++) {
+            int v = body.vertexOffset + i * body.vertexStride;
+            x[i] = EigenVector3(positions.x[v], positions.y[v], positions.z[v]);
+        }
+
+        body.model->invalidate();
+    }
+}
+
+//pushes 4 vertices back into the walls, lanes without a collision keep their velocity
+inline void Physics::processCollision(const Vector3f4& position, Vector3f4& velocity) {
+
+    const float halfSize = wallsSize * 0.5f;
+
+    const Scalarf4 zero = Scalarf4(0.0f);
+    Vector3f4 error;
+
+    for (int k = 0; k < 3; k++) {
+        Scalarf4 low = Scalarf4(wallsPosition[k] - halfSize);
+        Scalarf4 high = Scalarf4(wallsPosition[k] + halfSize);
+
+        error[k] = max(position[k] - high, min(position[k] - low, zero));
     }
+
+    const Scalarf4 epsilon = Scalarf4(10e-7f);
+
+    Scalarf4 colliding = (abs(error.x()) >= epsilon) | (abs(error.y()) >= epsilon) | (abs(error.z()) >= epsilon);
+
+    if (!any(colliding))
+        return;
+
+    //lanes without a collision divide by zero here, they are dropped by the blend below
+    Vector3f4 normal = -error * rsqrt(error.lengthSquared());
+
+    Vector3f4 normalVelocity = normal * (velocity * normal);
+
+    Vector3f4 tangentVelocity = velocity - normalVelocity;
+
+    const float friction = 1.0;
+
+    tangentVelocity -= tangentVelocity * Scalarf4(friction);
+
+    normalVelocity = normal * Scalarf4(500.0f * (float) stepDt);
+
+    velocity = Vector3f4::blend(colliding, tangentVelocity + normalVelocity, velocity);
 }
 
-//computes the deformation gradient of 8 tets
-inline void Physics::computeDeformationGradient(const vector<EigenVector3> &p,
-        const vector<vector<int>> &ind, int i, Vector3f4 & F1, Vector3f4 & F2, Vector3f4 & F3)
+void Physics::solveOptimizationProblem(Positions &p)
 {
-    Vector3f4 vertices[4];	//vertices of 8 tets
-    int regularPart = (nTets / 4) * 4;
-    int i4 = 4 * i;
+    //compute RHS of Equation (12)
+    //batches are split between the threads. in scatter mode every thread adds to its own partial RHS
+    //and after a barrier each thread sums up the partial results of one range of vertices.
+    //in gather mode the batches write to the staging area and each vertex pulls its entries from there.
+    //the instances of a thread share no vertices with the ones of the other threads, their RHS entries are written directly
+    double phaseStart = getTime();
+
+    int threadsUsed = std::min(workerPool.getThreadCount(), std::max(1, (int) vecSize / MIN_BATCHES_PER_THREAD));
+    bool gather = config.rhsAssembly == GatherAssembly;
+    void (*localStep)(const KernelData&, int, int, float*) =
+            config.localStep == FusedLocalStep ? kernels.localStep : kernels.localStepSplit;
+
+    auto task = [&](int threadIndex, int threadCount) {
+        if (threadIndex < threadsUsed) {
+            int batchBegin = (int) vecSize * threadIndex / threadsUsed;
+            int batchEnd = (int) vecSize * (threadIndex + 1) / threadsUsed;
+
+            if (gather)
+                localStep(kernelData, batchBegin, batchEnd, nullptr);
+            else {
+                Scalarf4* rhs = threadIndex == 0 ? RHS.data() : threadRHS[threadIndex - 1].data();
+
+                for (size_t i = 0; i < nBatchedVerts; i++)
+                    rhs[i] = Scalarf4(0.0f);
+
+                localStep(kernelData, batchBegin, batchEnd, (float*) rhs);
+            }
+        }
 
-    if (i4 < regularPart)
-    {
-        for (int j = 0; j < 4; j++)
-        {
-            const EigenVector3& p0_0 = p[ind[i4 + 0][j]];
-            const EigenVector3& p0_1 = p[ind[i4 + 1][j]];
-            const EigenVector3& p0_2 = p[ind[i4 + 2][j]];
-            const EigenVector3& p0_3 = p[ind[i4 + 3][j]];
-
-            vertices[j].x() = Scalarf4(p0_0[0], p0_1[0], p0_2[0], p0_3[0]);
-            vertices[j].y() = Scalarf4(p0_0[1], p0_1[1], p0_2[1], p0_3[1]);
-            vertices[j].z() = Scalarf4(p0_0[2], p0_1[2], p0_2[2], p0_3[2]);
+        //a serial run takes the instance ranges of all threads
+        for (size_t t = (size_t) threadIndex; t < threadInstanceRanges.size(); t += threadCount) {
+            const vector<InstanceRange>& ranges = threadInstanceRanges[t];
+            for (size_t r = 0; r < ranges.size(); r++) {
+                const InstanceGroup& group = *instanceGroups[ranges[r].group];
+                const unsigned int shapeVerts = group.factor->model->getAllVerticesCount();
+
+                for (unsigned int v = 0; v < shapeVerts; v++)
+                    for (int k = ranges[r].instanceBegin; k < ranges[r].instanceEnd; k++)
+                        RHS[group.data.vertexOffset + v * group.data.instanceCount + k] = Scalarf4(0.0f);
+
+                kernels.localStepInstanced(kernelData, group.data, ranges[r].instanceBegin, ranges[r].instanceEnd, (float*) RHS.data());
+            }
         }
+
+        if (threadCount > 1 && (gather || threadsUsed > 1))
+            workerPool.barrier();
+
+        int vertexBegin = (int) nBatchedVerts * threadIndex / threadCount;
+        int vertexEnd = (int) nBatchedVerts * (threadIndex + 1) / threadCount;
+
+        if (gather)
+            gatherRHS(vertexBegin, vertexEnd);
+        else
+            for (int t = 0; t < threadsUsed - 1; t++) {
+                const Scalarf4* partial = threadRHS[t].data();
+                for (int i = vertexBegin; i < vertexEnd; i++)
+                    RHS[i] += partial[i];
+            }
+    };
+
+    //without parallel work everything runs on the calling thread, the pool is not woken up
+    if (threadsUsed == 1 && instanceThreadCount <= 1)
+        task(0, 1);
+    else
+        workerPool.run(task);
+
+    double now = getTime();
+    timings.localStep += now - phaseStart;
+
+    //solve the linear system, the solver takes care of Eigen's fill-in reduction permutation.
+    //the instances of a group are solved together with the factor of their shape
+    triangularSolvers[timeStepLevel].solve(RHS.data(), &workerPool);
+    for (size_t g = 0; g < instanceGroups.size(); g++) {
+        const InstanceGroup& group = *instanceGroups[g];
+        group.triangularSolvers[timeStepLevel].solve(RHS.data() + group.data.vertexOffset, &workerPool, group.data.instanceCount);
     }
-    else    //add padding with vertices of last tet. (they are never read out)
+
+    for (int i = 0; i < nVertsPadded; i += 4)	// add result (delta_x) to the positions
     {
-        for (int j = 0; j < 4; j++)
-        {
-            Vector3f p0[4];
-            for (int k = regularPart; k < regularPart + 4; k++)
-                if (k < nTets) p0[k - regularPart] = p[ind[k][j]].cast<float>();
-                else p0[k - regularPart] = p[ind[nTets - 1][j]].cast<float>();
-
-            vertices[j].x() = Scalarf4(p0[0][0], p0[1][0], p0[2][0], p0[3][0]);
-            vertices[j].y() = Scalarf4(p0[0][1], p0[1][1], p0[2][1], p0[3][1]);
-            vertices[j].z() = Scalarf4(p0[0][2], p0[1][2], p0[2][2], p0[3][2]);
-        }
+        Vector3f4 dx;
+        Scalarf4 unused;
+        loadInterleaved((const float*) &RHS[i], dx.x(), dx.y(), dx.z(), unused);
+
+        p.store(i, p.load(i) + dx);
     }
 
-    // compute F as D_t*x (see Equation (9))
-    F1 = vertices[0] * DT[i][0][0] + vertices[1] * DT[i][1][0] + vertices[2] * DT[i][2][0] + vertices[3] * DT[i][3][0];
-    F2 = vertices[0] * DT[i][0][1] + vertices[1] * DT[i][1][1] + vertices[2] * DT[i][2][1] + vertices[3] * DT[i][3][1];
-    F3 = vertices[0] * DT[i][0][2] + vertices[1] * DT[i][1][2] + vertices[2] * DT[i][2][2] + vertices[3] * DT[i][3][2];
+    timings.triangularSolve += getTime() - now;
 }
 
-//computes the APD of 4 deformation gradients. (Alg. 3 from the paper)
-inline void Physics::APD_Newton_NEON(const Vector3f4& F1, const Vector3f4& F2, const Vector3f4& F3, Quaternion4f& q)
+//sums up the staged entries of the vertices [vertexBegin, vertexEnd)
+void Physics::gatherRHS(int vertexBegin, int vertexEnd)
 {
-    //one iteration is sufficient for plausible results
-    for (int it = 0; it<1; it++)
+    const Scalarf4* staging = RHS_staging.data();
+    const int* slots = RHS_gather_slots.data();
+
+    for (int i = vertexBegin; i < vertexEnd; i++)
     {
-        //transform quaternion to rotation matrix
-        Matrix3f4 R;
-        q.toRotationMatrix(R);
+        Scalarf4 sum = Scalarf4(0.0f);
+        for (int s = RHS_gather_offsets[i]; s < RHS_gather_offsets[i + 1]; s++)
+            sum += staging[slots[s]];
+
+        RHS[i] = sum;
+    }
+}
 
-        //columns of B = RT * F
-        Vector3f4 B0 = R.transpose() * F1;
-        Vector3f4 B1 = R.transpose() * F2;
-        Vector3f4 B2 = R.transpose() * F3;
+//Gauss-Seidel over the constraint phases. constraints of one phase share no vertices, so the batches
+//of a wide phase are split between the threads of the pool. a barrier separates a phase from the next one
+//unless both of them run on the physics thread alone
+void Physics::solveVolumeConstraints(Positions &x, int iterations) {
 
-        Vector3f4 gradient(B2[1] - B1[2], B0[2] - B2[0], B1[0] - B0[1]);
+    int phaseCount = (int) phaseSizes.size();
 
-        //compute Hessian, use the fact that it is symmetric
-        Scalarf4 h00 = B1[1] + B2[2];
-        Scalarf4 h11 = B0[0] + B2[2];
-        Scalarf4 h22 = B0[0] + B1[1];
-        Scalarf4 h01 = Scalarf4(-0.5) * (B1[0] + B0[1]);
-        Scalarf4 h02 = Scalarf4(-0.5) * (B2[0] + B0[2]);
-        Scalarf4 h12 = Scalarf4(-0.5) * (B2[1] + B1[2]);
+    bool parallel = false;
+    for (int phase = 0; phase < phaseCount; phase++)
+        parallel |= phaseThreads[phase] > 1;
+
+    if (!parallel) {
+        for (int it = 0; it < iterations; it++)
+            for (int phase = 0; phase < phaseCount; phase++)	//forall constraint phases
+                kernels.solveConstraints(kernelData, phase, phaseBatchOffsets[phase], phaseBatchOffsets[phase + 1]);
+        return;
+    }
 
-        Scalarf4 detH = Scalarf4(-1.0) * h02 * h02 * h11 + Scalarf4(2.0) * h01 * h02 * h12 - h00 * h12 * h12 - h01 * h01 * h22 + h00 * h11 * h22;
+    auto task = [&](int threadIndex, int threadCount) {
+        bool previousParallel = false;
 
-        Vector3f4 omega;
-        //compute symmetric inverse
-        const Scalarf4 factor = Scalarf4(-0.25) / detH;
-        omega[0] = (h11 * h22 - h12 * h12) * gradient[0]
-                   + (h02 * h12 - h01 * h22) * gradient[1]
-                   + (h01 * h12 - h02 * h11) * gradient[2];
-        omega[0] *= factor;
+        for (int it = 0; it < iterations; it++)
+            for (int phase = 0; phase < phaseCount; phase++)	//forall constraint phases
+            {
+                int threadsUsed = phaseThreads[phase];
 
-        omega[1] = (h02 * h12 - h01 * h22) * gradient[0]
-                   + (h00 * h22 - h02 * h02) * gradient[1]
-                   + (h01 * h02 - h00 * h12) * gradient[2];
-        omega[1] *= factor;
+                if ((it > 0 || phase > 0) && (threadsUsed > 1 || previousParallel))
+                    workerPool.barrier();
+                previousParallel = threadsUsed > 1;
 
-        omega[2] = (h01 * h12 - h02 * h11) * gradient[0]
-                   + (h01 * h02 - h00 * h12) * gradient[1]
-                   + (h00 * h11 - h01 * h01) * gradient[2];
-        omega[2] *= factor;
+                if (threadIndex >= threadsUsed)
+                    continue;
 
-        omega = Vector3f4::blend(abs(detH) < 1.0e-9f, gradient * Scalarf4(-1.0), omega);	//if det(H) = 0 use gradient descent, never happened in our tests, could also be removed
+                int phaseBegin = phaseBatchOffsets[phase];
+                int phaseBatchCount = phaseBatchOffsets[phase + 1] - phaseBegin;
 
-        //instead of clamping just use gradient descent. also works fine and does not require the norm
-        Scalarf4 useGD = blend(omega * gradient > Scalarf4(0.0), Scalarf4(1.0), Scalarf4(-1.0));
-        omega = Vector3f4::blend(useGD > Scalarf4(0.0), gradient * Scalarf4(-0.125), omega);
+                kernels.solveConstraints(kernelData, phase, phaseBegin + phaseBatchCount * threadIndex / threadsUsed,
+                                       phaseBegin + phaseBatchCount * (threadIndex + 1) / threadsUsed);
+            }
+    };
 
-        Scalarf4 l_omega2 = omega.lengthSquared();
-        const Scalarf4 w = (1.0 - l_omega2) / (1.0 + l_omega2);
-        const Vector3f4 vec = omega * (2.0 / (1.0 + l_omega2));
-        q = q * Quaternion4f(vec.x(), vec.y(), vec.z(), w);		//no normalization needed because the Cayley map returs a unit quaternion
-    }
+    workerPool.run(task);
 }
 
-void Physics::solveVolumeConstraints(vector<EigenVector3> &x, const vector<vector<int>> &ind) {
+//Jacobi iterations over the batches of the local step. every batch computes the updates of its constraints
+//from the same positions and writes them to the staging area, then every vertex applies the average
+//of the updates of its constraints. the threads meet at one barrier between these two passes
+void Physics::solveVolumeConstraintsJacobi(Positions &x, int iterations) {
 
-    for (int phase = 0; phase < volume_constraint_phases.size(); phase++)	//forall constraint phases
-    {
-        for (int constraint = 0; constraint < inv_mass_phases[phase].size(); constraint++)	//forall constraints in this phase
+    int threadsUsed = std::min(workerPool.getThreadCount(), std::max(1, (int) vecSize / MIN_CONSTRAINT_BATCHES_PER_THREAD));
+
+    auto task = [&](int threadIndex, int threadCount) {
+        int vertexBegin = (int) nBatchedVerts * threadIndex / threadCount;
+        int vertexEnd = (int) nBatchedVerts * (threadIndex + 1) / threadCount;
+
+        for (int it = 0; it < iterations; it++)
         {
-            //move the positions of 4 tetrahedrons to vector registers
-            Vector3f4 p[4];
+            if (it > 0)
+                workerPool.barrier();
 
-            int c4[4];	//indices of 4 tets
-            for (int k = 0; k < 4; k++)
-                if (4 * constraint + k < volume_constraint_phases[phase].size())
-                    c4[k] = volume_constraint_phases[phase][4 * constraint + k];
-                else
-                    c4[k] = 0;
+            if (threadIndex < threadsUsed)
+                kernels.stageConstraints(kernelData, (int) vecSize * threadIndex / threadsUsed, (int) vecSize * (threadIndex + 1) / threadsUsed);
 
-            for (int j = 0; j < 4; j++)
-            {
-                const EigenVector3& p0_0 = x[ind[c4[0]][j]];
-                const EigenVector3& p0_1 = x[ind[c4[1]][j]];
-                const EigenVector3& p0_2 = x[ind[c4[2]][j]];
-                const EigenVector3& p0_3 = x[ind[c4[3]][j]];
-
-                p[j].x() = Scalarf4(p0_0[0], p0_1[0], p0_2[0], p0_3[0]);
-                p[j].y() = Scalarf4(p0_0[1], p0_1[1], p0_2[1], p0_3[1]);
-                p[j].z() = Scalarf4(p0_0[2], p0_1[2], p0_2[2], p0_3[2]);
-            }
+            workerPool.barrier();
 
-            //solve the constraints
-            const float eps = 1e-6f;
-
-            //compute the volume using Eq. (14)
-            Vector3f4 d1 = p[1] - p[0];
-            Vector3f4 d2 = p[2] - p[0];
-            Vector3f4 d3 = p[3] - p[0];
-            Scalarf4 volume = (d1 % d2) * d3 * (1.0f / 6.0f);
-
-            //compute the gradients (see: supplemental document)
-            Vector3f4 grad1 = d2 % d3;
-            Vector3f4 grad2 = d3 % d1;
-            Vector3f4 grad3 = d1 % d2;
-            Vector3f4 grad0 = -grad1 - grad2 - grad3;
-
-            const Scalarf4& restVol = rest_volume_phases[phase][constraint];
-            const Scalarf4& alpha = alpha_phases[phase][constraint];
-            Scalarf4& kappa = kappa_phases[phase][constraint];
-
-            //compute the Lagrange multiplier update using Eq. (15)
-            Scalarf4 delta_kappa =
-                    inv_mass_phases[phase][constraint][0] * grad0.lengthSquared() +
-                    inv_mass_phases[phase][constraint][1] * grad1.lengthSquared() +
-                    inv_mass_phases[phase][constraint][2] * grad2.lengthSquared() +
-                    inv_mass_phases[phase][constraint][3] * grad3.lengthSquared() +
-                    alpha;
-
-            delta_kappa = (restVol - volume - alpha * kappa) / blend(abs(delta_kappa) < eps, 1.0f, delta_kappa);
-            kappa = kappa + delta_kappa;
-
-            //compute the position updates using Eq. (16)
-            p[0] = p[0] + grad0 * delta_kappa * inv_mass_phases[phase][constraint][0];
-            p[1] = p[1] + grad1 * delta_kappa * inv_mass_phases[phase][constraint][1];
-            p[2] = p[2] + grad2 * delta_kappa * inv_mass_phases[phase][constraint][2];
-            p[3] = p[3] + grad3 * delta_kappa * inv_mass_phases[phase][constraint][3];
-
-            //write the positions from the vector registers back to the positions array
-            for (int j = 0; j < 4; j++)
-            {
-                float px[4], py[4], pz[4];
-                p[j].x().store(px);
-                p[j].y().store(py);
-                p[j].z().store(pz);
-
-                for (int k = 0; k < 4; k++)
-                    if (4 * constraint + k < volume_constraint_phases[phase].size())
-                        x[ind[c4[k]][j]] = EigenVector3(px[k], py[k], pz[k]);
+            gatherConstraintUpdates(x, vertexBegin, vertexEnd);
+        }
+    };
+
+    workerPool.run(task);
+}
+
+//Gauss-Seidel over the constraints of the instances. every thread solves all constraints of its instances,
+//the iterations of one instance don't depend on the other ones, so no barriers are needed
+void Physics::solveInstancedConstraints(int iterations) {
+
+    if (instanceGroups.empty())
+        return;
+
+    //a serial run takes the instance ranges of all threads
+    auto task = [&](int threadIndex, int threadCount) {
+        for (size_t thread = (size_t) threadIndex; thread < threadInstanceRanges.size(); thread += threadCount) {
+            const vector<InstanceRange>& ranges = threadInstanceRanges[thread];
+
+            for (size_t r = 0; r < ranges.size(); r++) {
+                InstanceGroupData& group = instanceGroups[ranges[r].group]->data;
+
+                //resets the Lagrange multipliers of the instances
+                for (unsigned int t = 0; t < group.tetCount; t++)
+                    std::fill(group.kappa + t * group.instanceStride + ranges[r].instanceBegin,
+                              group.kappa + t * group.instanceStride + ranges[r].instanceEnd, 0.0f);
+
+                for (int it = 0; it < iterations; it++)
+                    kernels.solveConstraintsInstanced(kernelData, group, ranges[r].instanceBegin, ranges[r].instanceEnd);
             }
         }
+    };
+
+    if (instanceThreadCount <= 1)
+        task(0, 1);
+    else
+        workerPool.run(task);
+}
+
+//applies the averaged staged updates to the vertices [vertexBegin, vertexEnd)
+void Physics::gatherConstraintUpdates(Positions &x, int vertexBegin, int vertexEnd) {
+
+    const Scalarf4* staging = RHS_staging.data();
+    const int* slots = RHS_gather_slots.data();
+
+    for (int i = vertexBegin; i < vertexEnd; i++)
+    {
+        int count = RHS_gather_offsets[i + 1] - RHS_gather_offsets[i];
+        if (count == 0)
+            continue;
+
+        Scalarf4 sum = Scalarf4(0.0f);
+        for (int s = RHS_gather_offsets[i]; s < RHS_gather_offsets[i + 1]; s++)
+            sum += staging[slots[s]];
+
+        float delta[4];
+        sum.store(delta);
+
+        const float weight = 1.0f / count;
+        x.x[i] += delta[0] * weight;
+        x.y[i] += delta[1] * weight;
+        x.z[i] += delta[2] * weight;
     }
 }
 
@@ -770,12 +1949,39 @@ void Physics::saveSimulationState() {
 
 // getters/setters
 
+void Physics::setConfig(const PhysicsConfig& config) {
+    this->config = config;
+}
+
+const PhysicsConfig& Physics::getConfig() {
+    return this->config;
+}
+
 MeshAsset* Physics::getWalls() {
     return this->walls;
 }
 
 TetAsset* Physics::getModel() {
-    return this->model;
+    return this->bodies.empty() ? nullptr : this->bodies[0].model;
+}
+
+int Physics::getBodyCount() {
+    return (int) this->bodies.size();
+}
+
+TetAsset* Physics::getBody(int index) {
+    return this->bodies[index].model;
+}
+
+void Physics::getBodyPositions(int index, vector<EigenVector3>& x) {
+
+    const Body& body = this->bodies[index];
+
+    x.resize(body.vertexCount);
+    for (int i = 0; i < body.vertexCount; i++) {
+        int v = body.vertexOffset + i * body.vertexStride;
+        x[i] = EigenVector3(positions.x[v], positions.y[v], positions.z[v]);
+    }
 }
 
 void Physics::setGravity(EigenVector3& gravity) {
@@ -1,8 +1,7 @@
 #ifndef FEMFORANDROID_PHYSICS_H
 #define FEMFORANDROID_PHYSICS_H
 
-#include <glm/glm.hpp>
-
+#include <atomic>
 #include <string>
 
 #include <vector>
@@ -11,10 +10,85 @@
 #include "EigenTypes.h"
 #include "NEON_math.h"
 
+#include "Arena.h"
 #include "AssetManager.h"
+#include "Material.h"
+#include "SolverBatches.h"
+#include "TriangularSolver.h"
+#include "WorkerPool.h"
 
 using namespace std;
 
+enum RHSAssemblyMode {
+    //every batch adds its results to the RHS of its vertices
+    ScatterAssembly,
+    //every batch writes its results to a staging area, every vertex sums up its own entries
+    GatherAssembly
+};
+
+enum LocalStepKernel {
+    //gather, deformation gradient, rotation and RHS contributions as separate steps
+    SplitLocalStep,
+    //one pass per batch which keeps the intermediate results in registers and prefetches the next batches
+    FusedLocalStep
+};
+
+enum VolumeConstraintMode {
+    //Gauss-Seidel over the color phases, every constraint sees the updates of the previous phases
+    GaussSeidelConstraints,
+    //all constraints start from the same positions and the updates are averaged per vertex.
+    //runs over the tet batches of the local step without coloring, converges a bit slower
+    JacobiConstraints
+};
+
+//one soft body of the scene, all of them are made of the material of Physics
+struct BodyConfig {
+    string assetName = "model.tetbin";
+    EigenVector3 position = EigenVector3(0, 0, 0);
+    float scale = 1.0f;
+    EigenAngleAxis rotation = EigenAngleAxis(0.0f, EigenVector3(0, 0, 1));
+};
+
+struct PhysicsConfig {
+    //threads used by the substep including the physics thread, 0 means one thread per core
+    int threadCount = 0;
+    RHSAssemblyMode rhsAssembly = ScatterAssembly;
+    LocalStepKernel localStep = FusedLocalStep;
+    VolumeConstraintMode volumeConstraints = GaussSeidelConstraints;
+    //instruction set of the local step, volume constraint and triangular solve kernels,
+    //AutoKernels picks the widest one the CPU supports
+    KernelInstructionSet instructionSet = AutoKernels;
+    //tets per batch, picks the kernels if no instruction set is given: 4, 8 with AVX2, 16 with AVX-512. 0 for any
+    int laneWidth = 0;
+    //renumbering of the bodies applied when they are loaded
+    MeshOrdering meshOrdering = RCMOrdering;
+    //substeps run next to the scalar reference solvers after initialize to check the kernels, 0 skips the check
+    int validationSteps = 0;
+    //bodies of the scene, loaded by initialize
+    vector<BodyConfig> bodies = vector<BodyConfig>(1);
+    //material of all bodies at initialize, setMaterial changes it afterwards
+    Material material;
+    //time steps the physics thread may switch between under load: dt, 2 dt, 4 dt and so on.
+    //every one of them has its own factorization, 1 keeps the time step fixed
+    int timeStepLevels = 1;
+    //bodies of the same shape are simulated as instances of it, which share its constants and factorization.
+    //only with Gauss-Seidel constraints and for shapes of at least one SIMD block of bodies (laneWidth),
+    //otherwise every body is a block of the batched system
+    bool instanceBodies = true;
+};
+
+//wall time of the phases of the substeps since the last resetSubstepTimings, in seconds
+struct SubstepTimings {
+    long substeps = 0;
+    //explicit Euler and collisions
+    double integration = 0.0;
+    //RHS including its assembly
+    double localStep = 0.0;
+    double triangularSolve = 0.0;
+    double volumeConstraints = 0.0;
+    double publish = 0.0;
+};
+
 class Physics {
 public:
     static Physics& getInstance() {
@@ -30,84 +104,321 @@ private:
 
     int initialized;
 
+    PhysicsConfig config;
+
     unsigned int nVerts;
+    unsigned int nVertsPadded;
     unsigned int nTets;
     unsigned int vecSize;
+    //the vertices [0, nBatchedVerts) and the tets of the batches belong to the bodies that are not instanced
+    unsigned int nBatchedVerts;
+    unsigned int nBatchedTets;
 
     EigenVector3 gravity;
+    Material material;
 
-    //Cholesky factorization of the system matrix
-    Eigen::SparseMatrix<float, Eigen::ColMajor> matL;
-    Eigen::SparseMatrix<float, Eigen::ColMajor> matLT;
+    //Cholesky factor of the system matrix of the batched bodies for every level of the time step ladder.
+    //it is block diagonal with the factors of the bodies, they share the permutation
+    std::vector<Eigen::SparseMatrix<float, Eigen::ColMajor>> matL;
     Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> perm;
     Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> permInv;
+    //flattened forward and backward substitution of the factorizations, one per level
+    std::vector<TriangularSolver> triangularSolvers;
+    //positions of the solver as aligned structure of arrays, padded to a multiple of 4 vertices.
+    //every body gets a copy of its range only when the renderer took the previous one
+    struct Positions {
+        std::vector<float, AlignmentAllocator<float, 16>> x, y, z;
+
+        void resize(size_t n) { x.assign(n, 0.0f); y.assign(n, 0.0f); z.assign(n, 0.0f); }
+        void clear() { x.clear(); y.clear(); z.clear(); }
+
+        inline Vector3f4 load(int i) const {
+            Vector3f4 v;
+            v.x().load(&x[i]);
+            v.y().load(&y[i]);
+            v.z().load(&z[i]);
+            return v;
+        }
+        inline void store(int i, const Vector3f4& v) {
+            v.x().store(&x[i]);
+            v.y().store(&y[i]);
+            v.z().store(&z[i]);
+        }
+    };
+    Positions positions;
+    Positions positions_old;
     //temporal varialbes of the solver
-    std::vector<EigenVector3> x_old;
     std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>> RHS;
-    std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>> RHS_perm;
-    std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>> Kvec;
-    std::vector<std::vector<std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>>> DT;
-    std::vector<Quaternion4f, AlignmentAllocator<Quaternion4f, 16> > quats;
-    //variables for the volume constraints
-    std::vector<std::vector<int>> volume_constraint_phases;
-    std::vector<std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>> rest_volume_phases;
-    std::vector<std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>> alpha_phases;
-    std::vector<std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>> kappa_phases;
-    std::vector<std::vector<std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>>> inv_mass_phases;
+    //partial RHS of the helper threads, the physics thread writes to RHS directly
+    std::vector<std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>> threadRHS;
+    //gather assembly: one (x, y, z, 0) entry per batch, corner and lane
+    //and for every vertex the list of its entries in CSR format
+    std::vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>> RHS_staging;
+    std::vector<int> RHS_gather_offsets;
+    std::vector<int> RHS_gather_slots;
+
+    //per-tet constants in the order of the batches, the records of any lane width are built from them
+    struct TetConstants {
+        float DT[4][3];	//D_t^T
+        float K;	//2 * dt * dt * mu * rest volume, for the smallest time step
+        float restVolume;
+        float alpha;	//compliance of the volume constraint
+    };
+    std::vector<TetConstants> tetConstants;
+    std::vector<float> invMass;
+
+    //the factorization of one shape, shared by all bodies loaded from the same tetbin with the same scale and rotation.
+    //everything is in the order the tets of the shape were loaded. after initialize it is only used by the material thread
+    struct BodyFactor {
+        uint64_t shapeHash;
+        //first body of the shape, its rest pose and tets
+        TetAsset* model;
+        std::vector<TetConstants> tetConstants;
+        std::vector<float> invMass;
+        //diagonal of the lumped mass matrix for a density of 1
+        std::vector<float> lumpedMass;
+        //symbolic analysis of the system matrix, only the numeric factorization is repeated for a new material
+        Eigen::SimplicialLLT<Eigen::SparseMatrix<float>, Eigen::Lower, Eigen::AMDOrdering<int>> LLT;
+        bool symbolicAnalysisDone;
+        std::vector<Eigen::SparseMatrix<float, Eigen::ColMajor>> matL;
+        std::vector<int> permutation;
+    };
+    std::vector<BodyFactor*> factors;
+
+    //bodies of one shape simulated as instances of it, see InstanceGroupData. the constants of the tets, their order
+    //and the factorizations are stored once, an instance only adds its vertices and the state of its tets
+    struct InstanceGroup {
+        BodyFactor* factor;
+        //inverse of the fill-in reducing permutation of the shape
+        Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> permInv;
+        //the tets of the shape in the order of its constraint phases
+        std::vector<InstancedTet> tets;
+        //one solver per level of the time step ladder, every solve covers all instances
+        std::vector<TriangularSolver> triangularSolvers;
+        std::vector<float, AlignmentAllocator<float, 16>> quat;
+        std::vector<float, AlignmentAllocator<float, 16>> kappa;
+        InstanceGroupData data;
+    };
+    std::vector<InstanceGroup*> instanceGroups;
+
+    //instances of a group handled by one thread, the instances are independent of each other
+    struct InstanceRange {
+        int group;
+        int instanceBegin, instanceEnd;
+    };
+    //blocks of the lane width of all groups split evenly between the threads
+    std::vector<std::vector<InstanceRange>> threadInstanceRanges;
+    //threads with instance ranges, with at most one of them the instances run on the calling thread
+    int instanceThreadCount;
+
+    //the bodies are simulated as one system. vertex i of a body is vertex vertexOffset + i * vertexStride of the solver,
+    //the stride is 1 for the batched bodies and the instance count for the instanced ones
+    struct Body {
+        TetAsset* model;
+        BodyFactor* factor;
+        //null for a batched body
+        InstanceGroup* group;
+        unsigned int vertexOffset;
+        unsigned int vertexStride;
+        unsigned int vertexCount;
+    };
+    std::vector<Body> bodies;
+    //tets of the batched bodies with the vertex indices of the solver, in the order of the batches
+    vector<vector<int>> tets;
+
+    //all batch records in one block, in the order they are traversed. their lane width is the one of the kernels
+    Arena arena;
+    unsigned int constraintBatchCount;
+    size_t tetBatchSize;
+    size_t constraintBatchSize;
+    //constraint batches [phaseBatchOffsets[i], phaseBatchOffsets[i + 1]) form phase i of phaseSizes[i] constraints
+    std::vector<int> phaseBatchOffsets;
+    std::vector<int> phaseSizes;
+    //threads the batches of each phase are split between
+    std::vector<int> phaseThreads;
+
+    //local step and volume constraint kernels of the selected lane width, and the state they work on
+    SolverKernelTable kernels;
+    KernelData kernelData;
 
     EigenVector3 wallsPosition;
     float wallsSize;
 
     MeshAsset* walls;
-    TetAsset* model;
 
     const unsigned int HZ = 1000;
+    //the smallest time step, level 0 of the ladder
     const double dt = 1.0 / HZ;
     const unsigned int MAX_STEPS_LAG = HZ / 10;
+    const int MAX_TIME_STEP_LEVELS = 4;
+
+    //time step ladder: level i steps by dt * 2^i. the batch records hold K and alpha of the current level
+    int timeStepLevelCount;
+    int timeStepLevel;
+    double stepDt;
+    //average wall time of a substep, picks the level
+    double substepTime;
+    //a substep has to take less than this share of the time step to stay on a level, or to go down to one
+    const double TIME_STEP_UP_LOAD = 0.9;
+    const double TIME_STEP_DOWN_LOAD = 0.6;
+
+    SubstepTimings timings;
+
+    double getTimeStep(int level) const;
+    void setTimeStepLevel(int level);
+    void updateTimeStepLevel(double elapsed);
+
+    //the assets are loaded by initialize, everything else on the init thread.
+    //the physics thread only steps once solverReady is set
+    pthread_t initThread;
+    atomic<bool> solverReady;
+
+    static void* init_thread_entrypoint(void* opaque);
+    void initializeSolver();
 
     void initializeModel();
+    void computeFactorization(BodyFactor& factor);
+    static void computeInverseMasses(const BodyFactor& factor, const Material& material, std::vector<float>& invMass);
+    Eigen::SparseMatrix<float> assembleSystemMatrix(const BodyFactor& factor, const Material& material, double timeStep);
+    bool factorizeLadder(BodyFactor& factor, const Material& material, std::vector<Eigen::SparseMatrix<float, Eigen::ColMajor>>& L);
+    void initializePermutations();
+    void combineFactors(std::vector<Eigen::SparseMatrix<float, Eigen::ColMajor>>& L);
+    void combineInverseMasses(std::vector<float>& invMass);
+    void initializeTriangularSolvers(const std::vector<Eigen::SparseMatrix<float, Eigen::ColMajor>>& L,
+            const Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int>& permInv, std::vector<TriangularSolver>& solvers);
+    void initializeInstanceGroups();
+    void initializeInstanceState();
+    bool loadFactorizations(uint64_t key);
+    void saveFactorizations(uint64_t key);
+
+    //a new material prepared by the material thread: everything that takes longer than a substep.
+    //the physics thread swaps it in between two substeps
+    struct MaterialUpdate {
+        Material material;
+        std::vector<float> invMass;
+        std::vector<Eigen::SparseMatrix<float, Eigen::ColMajor>> matL;
+        std::vector<TriangularSolver> triangularSolvers;
+        //of every instance group
+        std::vector<std::vector<TriangularSolver>> groupSolvers;
+    };
+    atomic<MaterialUpdate*> pendingMaterialUpdate;
+
+    //the material thread runs as long as there are requests, a newer request replaces one not started yet
+    pthread_t materialThread;
+    pthread_mutex_t materialMutex;
+    Material requestedMaterial;
+    bool materialRequested;
+    bool materialThreadRunning;
+    bool materialThreadJoinable;
+    bool materialThreadStopping;
+
+    static void* material_thread_entrypoint(void* opaque);
+    void materialThreadLoop();
+    void stopMaterialThread();
+    MaterialUpdate* prepareMaterialUpdate(const Material& material);
+    void applyMaterialUpdate();
+    void scaleConstants(float kScale, float alphaScale, float invMassScale);
+    void scaleBatchRecords(float kScale, float alphaScale, float invMassScale);
+    template <int W>
+    void scaleBatchConstants(float kScale, float alphaScale, float invMassScale);
 
     pthread_t thread;
     int started;
 
+    //helper threads of the substep, the physics thread itself is the first thread of the pool
+    WorkerPool workerPool;
+    //below this amount of tet batches per thread the local step uses less threads
+    const int MIN_BATCHES_PER_THREAD = 32;
+    //below this amount of constraint batches per thread a phase uses less threads, down to the physics thread alone
+    const int MIN_CONSTRAINT_BATCHES_PER_THREAD = 16;
+    const int VOLUME_CONSTRAINT_ITERATIONS = 2;
+
     static void* thread_entrypoint(void* opaque);
     void threadLoop();
 
-    void convertToNEON(const vector<float>& v, vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>& vNEON);
-    void convertToNEON(const vector<vector<vector<float>>>& v,
-            vector<vector<vector<Scalarf4, AlignmentAllocator<Scalarf4, 16>>>>& vNEON);
-    void initializeVolumeConstraints(const vector<vector<int>> &ind, vector<float> &rest_volume,
-            vector<float> &invMass, float lambda);
-    void constraintGraphColoring(const vector<vector<int>>& particleIndices, int n,
-            vector<vector<int>>& coloring);
+    void selectKernels();
+    void switchKernels(const SolverKernelTable& table);
+    void batchTets(vector<vector<int>> &ind);
+    void initializeBatches();
+    template <int W>
+    void initializeBatchRecords(const vector<vector<int>> &ind, const vector<vector<int>> &phases);
+    template <int W>
+    void initializeTetBatches(TetBatch<W>* batches, const vector<vector<int>> &ind);
+    template <int W>
+    void initializeVolumeConstraints(ConstraintBatch<W>* batches, ConstraintBatch<W>* jacobi,
+            const vector<vector<int>> &ind, const vector<vector<int>> &phases);
+    template <int W>
+    void initializeConstraintBatch(ConstraintBatch<W> &batch, const int* c, int lanes, const vector<vector<int>> &ind);
+    void resetMultipliers(void* batches, int count);
 
     void advance();
     void subStep();
 
-    void processCollision(EigenVector3& position, EigenVector3& velocity);
+    void publishPositions();
+
+    inline void processCollision(const Vector3f4& position, Vector3f4& velocity);
 
-    void solveOptimizationProblem(vector<EigenVector3> &p, const vector<vector<int>> &ind);
-    inline void computeDeformationGradient(const vector<EigenVector3> &p, const vector<vector<int>> &ind,
-            int i, Vector3f4 & F1, Vector3f4 & F2, Vector3f4 & F3);
-    inline void APD_Newton_NEON(const Vector3f4& F1, const Vector3f4& F2, const Vector3f4& F3, Quaternion4f& q);
+    void solveOptimizationProblem(Positions &p);
+    void initializeRHSGather(const vector<vector<int>> &ind);
+    void gatherRHS(int vertexBegin, int vertexEnd);
 
-    void solveVolumeConstraints(vector<EigenVector3> &x, const vector<vector<int>> &ind);
+    void solveVolumeConstraints(Positions &x, int iterations);
+    void solveVolumeConstraintsJacobi(Positions &x, int iterations);
+    void solveInstancedConstraints(int iterations);
+    void gatherConstraintUpdates(Positions &x, int vertexBegin, int vertexEnd);
+
+    void logMemoryFootprint();
 
     const string STATE_FILE_NAME = "state.bin";
+    const string FACTOR_CACHE_FILE_NAME = "factor.bin";
 
     void loadSimulationState();
     void saveSimulationState();
 
     void benchmark();
+    void benchmarkLocalStep();
+    void benchmarkExpressions();
+    void benchmarkKernels();
+
+    template <typename Real>
+    static double computeDivergence(const Positions& p, const vector<Eigen::Matrix<Real, 3, 1>>& reference);
+    void validate(int steps);
 public:
+    //loads the walls and the bodies and returns, the solver is prepared on a background thread.
+    //the bodies can be drawn right away in their rest pose
     void initialize();
+    //waits for the solver preparation if it is still running
     void finalize();
 
+    bool isSolverReady() const;
+
+    //the thread count, the kernels, the bodies, the mesh ordering and the time steps take effect on the next initialize.
+    //a switch of the volume constraints only applies to the batched bodies, instanced ones keep Gauss-Seidel
+    void setConfig(const PhysicsConfig& config);
+    const PhysicsConfig& getConfig();
+
+    //the physics thread waits for the solver preparation before the first substep
     void start();
     void stop();
+    //runs substeps on the calling thread instead of the physics thread, for headless runs.
+    //waits for the solver preparation, keeps the time step level
+    void step(int substeps);
+    double getCurrentTimeStep() const;
+
+    const SubstepTimings& getSubstepTimings() const;
+    void resetSubstepTimings();
 
     MeshAsset* getWalls();
+    //the first body
     TetAsset* getModel();
+    int getBodyCount();
+    TetAsset* getBody(int index);
+    //current positions of the solver for a body, unlike getBody they don't wait for the renderer
+    void getBodyPositions(int index, vector<EigenVector3>& x);
+
+    //refactorizes the system matrix for the material in the background, the simulation keeps running
+    //with the previous material until the new one is swapped in between two substeps
+    void setMaterial(const Material& material);
 
     EigenVector3& getGravity();
     void setGravity(EigenVector3& gravity);
@@ -0,0 +1,308 @@
+#include "ReferenceSolver.h"
+
+#include "exceptionUtils.h"
+
+using namespace Eigen;
+
+template <typename Real>
+void ReferenceSolver<Real>::initialize(const vector<EigenVector3>& vertices, const vector<vector<int>>& tetIndices,
+        const ReferenceSettings& settings) {
+
+    this->settings = settings;
+
+    const int nVerts = (int) vertices.size();
+    const int nTets = (int) tetIndices.size();
+    const Real dt = (Real) settings.dt;
+    const Real density = settings.material.density;
+    const Real mu = settings.material.getMu();
+    const Real lambda = settings.material.getLambda();
+
+    positions.resize(nVerts);
+    for (int i = 0; i < nVerts; i++)
+        positions[i] = vertices[i].cast<Real>();
+    positions_old = positions;
+
+    tets.resize(nTets);
+    invMass.assign(nVerts, 0.0);
+    vertexTetCounts.assign(nVerts, 0);
+
+    vector<Triplet<Real>> triplets_D, triplets_K, triplets_M;
+
+    for (int t = 0; t < nTets; t++)
+    {
+        Tet& tet = tets[t];
+        for (int j = 0; j < 4; j++) {
+            tet.indices[j] = tetIndices[t][j];
+            vertexTetCounts[tet.indices[j]]++;
+        }
+
+        Matrix3 Dm;
+        for (int j = 0; j < 3; j++)
+            Dm.col(j) = positions[tet.indices[j + 1]] - positions[tet.indices[0]];
+
+        tet.restVolume = Dm.determinant() / 6.0;
+        my_assert(tet.restVolume >= 0.0);
+
+        tet.alpha = 1.0 / (lambda * tet.restVolume * dt * dt);
+        tet.K = 2.0 * dt * dt * mu * tet.restVolume;
+        tet.kappa = 0.0;
+        tet.q = Quaternion::Identity();
+
+        Matrix3 Dm_inv = Dm.inverse();
+        for (int k = 0; k < 3; k++)
+            tet.DT[0][k] = -Dm_inv(0, k) - Dm_inv(1, k) - Dm_inv(2, k);
+        for (int j = 1; j < 4; j++)
+            for (int k = 0; k < 3; k++)
+                tet.DT[j][k] = Dm_inv(j - 1, k);
+
+        for (int j = 0; j < 9; j++)
+            triplets_K.push_back(Triplet<Real>(9 * t + j, 9 * t + j, tet.K));
+
+        //the same mass matrix as Physics::initializeModel, which adds the mass of the vertex so far for every corner
+        for (int j = 0; j < 4; j++)
+        {
+            invMass[tet.indices[j]] += 0.25 * density * tet.restVolume;
+            triplets_M.push_back(Triplet<Real>(tet.indices[j], tet.indices[j], invMass[tet.indices[j]]));
+        }
+
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 3; j++)
+                triplets_D.push_back(Triplet<Real>(9 * t + 3 * j, tet.indices[i], tet.DT[i][j]));
+    }
+
+    SparseMatrix K(9 * nTets, 9 * nTets);
+    SparseMatrix D(9 * nTets, nVerts);
+    SparseMatrix M(nVerts, nVerts);
+    K.setFromTriplets(triplets_K.begin(), triplets_K.end());
+    D.setFromTriplets(triplets_D.begin(), triplets_D.end());
+    M.setFromTriplets(triplets_M.begin(), triplets_M.end());
+
+    SparseMatrix M_plus_DT_K_D = M + SparseMatrix(D.transpose()) * K * D;
+    LLT.compute(M_plus_DT_K_D);
+    my_assert(LLT.info() == Success);
+
+    for (int i = 0; i < nVerts; i++)
+        invMass[i] = 1.0 / invMass[i];
+
+    RHS.resize(nVerts, 3);
+}
+
+template <typename Real>
+void ReferenceSolver<Real>::finalize() {
+
+    tets.clear();
+    invMass.clear();
+    vertexTetCounts.clear();
+    positions.clear();
+    positions_old.clear();
+}
+
+template <typename Real>
+const vector<typename ReferenceSolver<Real>::Vector3>& ReferenceSolver<Real>::getPositions() const {
+    return positions;
+}
+
+template <typename Real>
+void ReferenceSolver<Real>::subStep() {
+
+    const Real dt = (Real) settings.dt;
+    const Vector3 gravityStep = settings.gravity.cast<Real>() * dt;
+
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        Vector3 x = positions[i];
+        Vector3 v = (x - positions_old[i]) / dt + gravityStep;
+
+        processCollision(x, v);
+
+        positions_old[i] = x;
+        positions[i] = x + v * dt;
+    }
+
+    solveOptimizationProblem();
+
+    for (size_t t = 0; t < tets.size(); t++)
+        tets[t].kappa = 0.0;
+
+    solveVolumeConstraints();
+}
+
+//same as Physics::processCollision for a single vertex
+template <typename Real>
+void ReferenceSolver<Real>::processCollision(const Vector3& position, Vector3& velocity) const {
+
+    const Real halfSize = settings.wallsSize * 0.5f;
+
+    Vector3 error;
+    for (int k = 0; k < 3; k++) {
+        Real low = settings.wallsPosition[k] - halfSize;
+        Real high = settings.wallsPosition[k] + halfSize;
+
+        error[k] = std::max(position[k] - high, std::min(position[k] - low, (Real) 0.0));
+    }
+
+    const Real epsilon = 10e-7;
+    if (std::abs(error.x()) < epsilon && std::abs(error.y()) < epsilon && std::abs(error.z()) < epsilon)
+        return;
+
+    Vector3 normal = -error.normalized();
+
+    Vector3 normalVelocity = normal * velocity.dot(normal);
+    Vector3 tangentVelocity = velocity - normalVelocity;
+
+    const Real friction = 1.0;
+    tangentVelocity -= tangentVelocity * friction;
+
+    normalVelocity = normal * (Real) (500.0 * settings.dt);
+
+    velocity = tangentVelocity + normalVelocity;
+}
+
+template <typename Real>
+void ReferenceSolver<Real>::solveOptimizationProblem() {
+
+    RHS.setZero();
+
+    for (size_t t = 0; t < tets.size(); t++)
+    {
+        Tet& tet = tets[t];
+
+        //F = D_t * x
+        Matrix3 F = Matrix3::Zero();
+        for (int j = 0; j < 4; j++)
+            for (int k = 0; k < 3; k++)
+                F.col(k) += positions[tet.indices[j]] * tet.DT[j][k];
+
+        APD_Newton(F, tet.q);
+
+        Matrix3 RF = tet.q.toRotationMatrix() - F;
+
+        for (int k = 0; k < 4; k++)
+        {
+            Vector3 dx = (RF.col(0) * tet.DT[k][0] + RF.col(1) * tet.DT[k][1] + RF.col(2) * tet.DT[k][2]) * tet.K;
+            RHS.row(tet.indices[k]) += dx.transpose();
+        }
+    }
+
+    Eigen::Matrix<Real, Eigen::Dynamic, 3> dx = LLT.solve(RHS);
+
+    for (size_t i = 0; i < positions.size(); i++)
+        positions[i] += dx.row(i).transpose();
+}
+
+//one Newton iteration of the APD like SolverKernels::APD_Newton
+template <typename Real>
+void ReferenceSolver<Real>::APD_Newton(const Matrix3& F, Quaternion& q) {
+
+    Matrix3 B = q.toRotationMatrix().transpose() * F;
+
+    Vector3 gradient(B(1, 2) - B(2, 1), B(2, 0) - B(0, 2), B(0, 1) - B(1, 0));
+
+    Real h00 = B(1, 1) + B(2, 2);
+    Real h11 = B(0, 0) + B(2, 2);
+    Real h22 = B(0, 0) + B(1, 1);
+    Real h01 = -0.5 * (B(0, 1) + B(1, 0));
+    Real h02 = -0.5 * (B(0, 2) + B(2, 0));
+    Real h12 = -0.5 * (B(1, 2) + B(2, 1));
+
+    Matrix3 H;
+    H << h00, h01, h02,
+         h01, h11, h12,
+         h02, h12, h22;
+
+    Real detH = H.determinant();
+
+    Vector3 omega;
+    if (std::abs(detH) < 1.0e-9)
+        omega = -gradient;
+    else
+        omega = (H.inverse() * gradient) * -0.25;
+
+    if (omega.dot(gradient) > 0.0)
+        omega = gradient * -0.125;
+
+    Real l_omega2 = omega.squaredNorm();
+    Real w = (1.0 - l_omega2) / (1.0 + l_omega2);
+    Vector3 vec = omega * (2.0 / (1.0 + l_omega2));
+
+    q = q * Quaternion(w, vec.x(), vec.y(), vec.z());
+}
+
+template <typename Real>
+void ReferenceSolver<Real>::solveVolumeConstraints() {
+
+    Vector3 p[4], dp[4];
+
+    for (int it = 0; it < settings.constraintIterations; it++)
+    {
+        if (!settings.constraintOrder.empty())
+        {
+            for (size_t c = 0; c < settings.constraintOrder.size(); c++)
+            {
+                Tet& tet = tets[settings.constraintOrder[c]];
+
+                for (int j = 0; j < 4; j++)
+                    p[j] = positions[tet.indices[j]];
+
+                computeConstraint(tet, p, dp);
+
+                for (int j = 0; j < 4; j++)
+                    positions[tet.indices[j]] += dp[j];
+            }
+            continue;
+        }
+
+        vector<Vector3> updates(positions.size(), Vector3::Zero());
+
+        for (size_t t = 0; t < tets.size(); t++)
+        {
+            Tet& tet = tets[t];
+
+            for (int j = 0; j < 4; j++)
+                p[j] = positions[tet.indices[j]];
+
+            computeConstraint(tet, p, dp);
+
+            for (int j = 0; j < 4; j++)
+                updates[tet.indices[j]] += dp[j];
+        }
+
+        for (size_t i = 0; i < positions.size(); i++)
+            if (vertexTetCounts[i] > 0)
+                positions[i] += updates[i] / (Real) vertexTetCounts[i];
+    }
+}
+
+//XPBD update of one volume constraint, like SolverKernels::computeConstraintBatch
+template <typename Real>
+void ReferenceSolver<Real>::computeConstraint(Tet& tet, const Vector3 p[4], Vector3 dp[4]) const {
+
+    const Real eps = 1e-6;
+
+    Vector3 d1 = p[1] - p[0];
+    Vector3 d2 = p[2] - p[0];
+    Vector3 d3 = p[3] - p[0];
+    Real volume = d1.cross(d2).dot(d3) / 6.0;
+
+    Vector3 grad[4];
+    grad[1] = d2.cross(d3);
+    grad[2] = d3.cross(d1);
+    grad[3] = d1.cross(d2);
+    grad[0] = -grad[1] - grad[2] - grad[3];
+
+    Real denominator = tet.alpha;
+    for (int j = 0; j < 4; j++)
+        denominator += invMass[tet.indices[j]] * grad[j].squaredNorm();
+
+    if (std::abs(denominator) < eps)
+        denominator = 1.0;
+
+    Real delta_kappa = (tet.restVolume - volume - tet.alpha * tet.kappa) / denominator;
+    tet.kappa += delta_kappa;
+
+    for (int j = 0; j < 4; j++)
+        dp[j] = grad[j] * delta_kappa * invMass[tet.indices[j]];
+}
+
+template class ReferenceSolver<float>;
+template class ReferenceSolver<double>;
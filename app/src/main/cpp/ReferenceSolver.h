@@ -0,0 +1,78 @@
+#ifndef FEMFORANDROID_REFERENCE_SOLVER_H
+#define FEMFORANDROID_REFERENCE_SOLVER_H
+
+#include <vector>
+
+#include "Eigen/Sparse"
+
+#include "EigenTypes.h"
+#include "Material.h"
+
+using namespace std;
+
+// what the reference solver takes over from Physics. the constraints are either solved one after another
+// in constraintOrder (Gauss-Seidel), or all from the same positions with the updates averaged per vertex (Jacobi)
+// if constraintOrder is empty
+struct ReferenceSettings {
+    Material material;
+    double dt;
+    EigenVector3 gravity;
+    EigenVector3 wallsPosition;
+    float wallsSize;
+    int constraintIterations;
+    vector<int> constraintOrder;
+};
+
+// the substep of Physics in plain C++ for one floating point type: explicit Euler with the wall collisions,
+// the corotated local step, the global step solved with Eigen's Cholesky factorization and the XPBD volume constraints.
+// no SIMD, no batches, no threads, every constant is computed from the rest pose again.
+// it is the baseline the vectorized solver is checked against, see Physics::validate
+template <typename Real>
+class ReferenceSolver {
+public:
+    typedef Eigen::Matrix<Real, 3, 1> Vector3;
+    typedef Eigen::Matrix<Real, 3, 3> Matrix3;
+    typedef Eigen::Quaternion<Real> Quaternion;
+    typedef Eigen::SparseMatrix<Real> SparseMatrix;
+
+private:
+    struct Tet {
+        int indices[4];
+        Real DT[4][3];	//D_t^T
+        Real K;	//2 * dt * dt * mu * rest volume
+        Real restVolume;
+        Real alpha;	//compliance of the volume constraint
+        Real kappa;	//Lagrange multiplier of the volume constraint
+        Quaternion q;	//rotation of the last substep, initial guess of the APD
+    };
+
+    ReferenceSettings settings;
+
+    vector<Tet> tets;
+    vector<Real> invMass;
+    vector<int> vertexTetCounts;
+
+    vector<Vector3> positions;
+    vector<Vector3> positions_old;
+
+    Eigen::SimplicialLLT<SparseMatrix, Eigen::Lower, Eigen::AMDOrdering<int>> LLT;
+    Eigen::Matrix<Real, Eigen::Dynamic, 3> RHS;
+
+    void processCollision(const Vector3& position, Vector3& velocity) const;
+
+    void solveOptimizationProblem();
+    static void APD_Newton(const Matrix3& F, Quaternion& q);
+
+    void solveVolumeConstraints();
+    void computeConstraint(Tet& tet, const Vector3 p[4], Vector3 dp[4]) const;
+public:
+    // rest pose of the model, its vertices are also the initial positions
+    void initialize(const vector<EigenVector3>& vertices, const vector<vector<int>>& tets, const ReferenceSettings& settings);
+    void finalize();
+
+    void subStep();
+
+    const vector<Vector3>& getPositions() const;
+};
+
+#endif //FEMFORANDROID_REFERENCE_SOLVER_H
@@ -245,9 +245,8 @@ void Render::finalizeGL() {
     if (walls)
         walls->invalidate(true);
 
-    TetAsset* model = Physics::getInstance().getModel();
-    if (model)
-        model->invalidate(true);
+    for (int b = 0; b < Physics::getInstance().getBodyCount(); b++)
+        Physics::getInstance().getBody(b)->invalidate(true);
 }
 
 void Render::updateProjectionMatrix() {
@@ -322,12 +321,16 @@ void Render::draw() {
     if (this->window == nullptr)
         return;
 
-    MeshAsset* walls = Physics::getInstance().getWalls();
-    TetAsset* model = Physics::getInstance().getModel();
+    Physics& physics = Physics::getInstance();
+
+    MeshAsset* walls = physics.getWalls();
+    TetAsset* model = physics.getModel();
 
     walls->syncWithGPU();
-    model->syncWithGPU();
+    for (int b = 0; b < physics.getBodyCount(); b++)
+        physics.getBody(b)->syncWithGPU();
 
+    // the camera follows the first body
     EigenVector3 position = model->getPosition();
 
     lookAtPoint(vec3(position.x(), position.y(), position.z()));
@@ -335,7 +338,8 @@ void Render::draw() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     drawAsset((GPUAsset*) walls, wallTexture);
-    drawAsset((GPUAsset*) model, modelTexture);
+    for (int b = 0; b < physics.getBodyCount(); b++)
+        drawAsset((GPUAsset*) physics.getBody(b), modelTexture);
 
     // glFlush(); // do we need this or what?
 
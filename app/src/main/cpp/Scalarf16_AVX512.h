@@ -0,0 +1,238 @@
+#ifndef FEMFORANDROID_SCALARF16_AVX512_H
+#define FEMFORANDROID_SCALARF16_AVX512_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+SIMD_NAMESPACE_BEGIN
+
+// ----------------------------------------------------------------------------------------------
+//vector of 16 float values to represent 16 scalars, AVX-512 counterpart of Scalarf8.
+//only AVX512F is used. its comparisons produce bit masks, they are widened to the usual vector masks
+//so the SIMD types of NEON_math.h work unchanged
+class Scalarf16
+{
+public:
+	static const int WIDTH = 16;
+
+	__m512 v;
+
+	Scalarf16() {}
+
+	Scalarf16(float f) {
+		v = _mm512_set1_ps(f);
+	}
+
+	Scalarf16(__m512 const & x) {
+		v = x;
+	}
+
+	Scalarf16 & operator = (__m512 const & x) {
+		v = x;
+		return *this;
+	}
+
+	Scalarf16& load(float const * p) {
+		v = _mm512_loadu_ps(p);
+		return *this;
+	}
+
+	//lane i gets base[index[i]]
+	Scalarf16& gather(float const * base, int32_t const * index) {
+		v = _mm512_i32gather_ps(_mm512_loadu_si512(index), base, 4);
+		return *this;
+	}
+
+	void store(float * p) const {
+		_mm512_storeu_ps(p, v);
+	}
+};
+
+static inline Scalarf16 maskToScalarf16(__mmask16 m) {
+	return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(m, -1));
+}
+
+static inline __mmask16 scalarf16ToMask(Scalarf16 const & c) {
+	__m512i bits = _mm512_castps_si512(c.v);
+	return _mm512_test_epi32_mask(bits, bits);
+}
+
+static inline Scalarf16 operator + (Scalarf16 const & a, Scalarf16 const & b) {
+	return _mm512_add_ps(a.v, b.v);
+}
+
+static inline Scalarf16 & operator += (Scalarf16 & a, Scalarf16 const & b) {
+	a.v = _mm512_add_ps(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf16 operator - (Scalarf16 const & a, Scalarf16 const & b) {
+	return _mm512_sub_ps(a.v, b.v);
+}
+
+static inline Scalarf16 & operator -= (Scalarf16 & a, Scalarf16 const & b) {
+	a.v = _mm512_sub_ps(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf16 operator * (Scalarf16 const & a, Scalarf16 const & b) {
+	return _mm512_mul_ps(a.v, b.v);
+}
+
+static inline Scalarf16 & operator *= (Scalarf16 & a, Scalarf16 const & b) {
+	a.v = _mm512_mul_ps(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf16 operator / (Scalarf16 const & a, Scalarf16 const & b) {
+	return _mm512_div_ps(a.v, b.v);
+}
+
+//a + b * c
+static inline Scalarf16 multiplyAdd(Scalarf16 const & a, Scalarf16 const & b, Scalarf16 const & c) {
+	return _mm512_fmadd_ps(b.v, c.v, a.v);
+}
+
+//a - b * c
+static inline Scalarf16 multiplySub(Scalarf16 const & a, Scalarf16 const & b, Scalarf16 const & c) {
+	return _mm512_fnmadd_ps(b.v, c.v, a.v);
+}
+
+static inline Scalarf16 operator == (Scalarf16 const & a, Scalarf16 const & b) {
+	return maskToScalarf16(_mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ));
+}
+
+static inline Scalarf16 operator != (Scalarf16 const & a, Scalarf16 const & b) {
+	return maskToScalarf16(_mm512_cmp_ps_mask(a.v, b.v, _CMP_NEQ_UQ));
+}
+
+static inline Scalarf16 operator < (Scalarf16 const & a, Scalarf16 const & b) {
+	return maskToScalarf16(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ));
+}
+
+static inline Scalarf16 operator <= (Scalarf16 const & a, Scalarf16 const & b) {
+	return maskToScalarf16(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ));
+}
+
+static inline Scalarf16 operator > (Scalarf16 const & a, Scalarf16 const & b) {
+	return maskToScalarf16(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ));
+}
+
+static inline Scalarf16 operator >= (Scalarf16 const & a, Scalarf16 const & b) {
+	return maskToScalarf16(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ));
+}
+
+//and/or on floats need AVX512DQ, the integer versions do the same
+static inline Scalarf16 abs(Scalarf16 const & a) {
+	return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a.v), _mm512_set1_epi32(0x7FFFFFFF)));
+}
+
+static inline Scalarf16 min(Scalarf16 const & a, Scalarf16 const & b) {
+	return _mm512_min_ps(a.v, b.v);
+}
+
+static inline Scalarf16 max(Scalarf16 const & a, Scalarf16 const & b) {
+	return _mm512_max_ps(a.v, b.v);
+}
+
+//the estimate has 14 bits, one Newton-Raphson step as for SSE
+static inline Scalarf16 rsqrt(Scalarf16 const & a) {
+
+	__m512 e = _mm512_rsqrt14_ps(a.v);
+
+	e = _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), e),
+					  _mm512_sub_ps(_mm512_set1_ps(3.0f), _mm512_mul_ps(_mm512_mul_ps(a.v, e), e)));
+
+	return e;
+}
+
+//logical operations on the masks returned by the comparisons
+static inline Scalarf16 operator & (Scalarf16 const & a, Scalarf16 const & b) {
+	return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a.v), _mm512_castps_si512(b.v)));
+}
+
+static inline Scalarf16 operator | (Scalarf16 const & a, Scalarf16 const & b) {
+	return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a.v), _mm512_castps_si512(b.v)));
+}
+
+//true if any element of the mask is set
+static inline bool any(Scalarf16 const & c) {
+	return scalarf16ToMask(c) != 0;
+}
+
+//does the same as for (int i = 0; i < 16; i++) result[i] = c[i] ? a[i] : b[i];
+//the elemets in c must be either 0 (false) or 0xFFFFFFFF (true)
+static inline Scalarf16 blend(Scalarf16 const & c, Scalarf16 const & a, Scalarf16 const & b) {
+	return _mm512_mask_blend_ps(scalarf16ToMask(c), b.v, a.v);
+}
+
+//stores 4 vectors interleaved, p[4 * i + j] gets lane i of the j-th vector.
+//4x4 transposes within the 128 bit blocks like for Scalarf8, then the blocks are put in lane order
+static inline void storeInterleaved(float * p, Scalarf16 const & a, Scalarf16 const & b, Scalarf16 const & c, Scalarf16 const & d) {
+	__m512 t0 = _mm512_unpacklo_ps(a.v, b.v);
+	__m512 t1 = _mm512_unpackhi_ps(a.v, b.v);
+	__m512 t2 = _mm512_unpacklo_ps(c.v, d.v);
+	__m512 t3 = _mm512_unpackhi_ps(c.v, d.v);
+
+	__m512 r0 = _mm512_shuffle_ps(t0, t2, 0x44);	//lanes 0, 4, 8 and 12
+	__m512 r1 = _mm512_shuffle_ps(t0, t2, 0xEE);	//lanes 1, 5, 9 and 13
+	__m512 r2 = _mm512_shuffle_ps(t1, t3, 0x44);	//lanes 2, 6, 10 and 14
+	__m512 r3 = _mm512_shuffle_ps(t1, t3, 0xEE);	//lanes 3, 7, 11 and 15
+
+	__m512 low01 = _mm512_shuffle_f32x4(r0, r1, _MM_SHUFFLE(1, 0, 1, 0));
+	__m512 low23 = _mm512_shuffle_f32x4(r2, r3, _MM_SHUFFLE(1, 0, 1, 0));
+	__m512 high01 = _mm512_shuffle_f32x4(r0, r1, _MM_SHUFFLE(3, 2, 3, 2));
+	__m512 high23 = _mm512_shuffle_f32x4(r2, r3, _MM_SHUFFLE(3, 2, 3, 2));
+
+	_mm512_storeu_ps(p, _mm512_shuffle_f32x4(low01, low23, _MM_SHUFFLE(2, 0, 2, 0)));
+	_mm512_storeu_ps(p + 16, _mm512_shuffle_f32x4(low01, low23, _MM_SHUFFLE(3, 1, 3, 1)));
+	_mm512_storeu_ps(p + 32, _mm512_shuffle_f32x4(high01, high23, _MM_SHUFFLE(2, 0, 2, 0)));
+	_mm512_storeu_ps(p + 48, _mm512_shuffle_f32x4(high01, high23, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+//storeInterleaved into registers, lanes[i] gets lane i of a, b, c and d as a vector of Scalarf4
+static inline void interleave(Scalarf16 const & a, Scalarf16 const & b, Scalarf16 const & c, Scalarf16 const & d, Scalarf4 (&lanes)[16]) {
+	__m512 t0 = _mm512_unpacklo_ps(a.v, b.v);
+	__m512 t1 = _mm512_unpackhi_ps(a.v, b.v);
+	__m512 t2 = _mm512_unpacklo_ps(c.v, d.v);
+	__m512 t3 = _mm512_unpackhi_ps(c.v, d.v);
+
+	__m512 r[4] = { _mm512_shuffle_ps(t0, t2, 0x44), _mm512_shuffle_ps(t0, t2, 0xEE),
+		_mm512_shuffle_ps(t1, t3, 0x44), _mm512_shuffle_ps(t1, t3, 0xEE) };
+
+	for (int i = 0; i < 4; i++) {
+		lanes[i] = _mm512_castps512_ps128(r[i]);
+		lanes[i + 4] = _mm512_extractf32x4_ps(r[i], 1);
+		lanes[i + 8] = _mm512_extractf32x4_ps(r[i], 2);
+		lanes[i + 12] = _mm512_extractf32x4_ps(r[i], 3);
+	}
+}
+
+//inverse of storeInterleaved, lane i of the j-th vector gets p[4 * i + j]
+static inline void loadInterleaved(float const * p, Scalarf16 & a, Scalarf16 & b, Scalarf16 & c, Scalarf16 & d) {
+	__m512 l0 = _mm512_loadu_ps(p), l1 = _mm512_loadu_ps(p + 16), l2 = _mm512_loadu_ps(p + 32), l3 = _mm512_loadu_ps(p + 48);
+
+	__m512 low01 = _mm512_shuffle_f32x4(l0, l1, _MM_SHUFFLE(1, 0, 1, 0));
+	__m512 low23 = _mm512_shuffle_f32x4(l2, l3, _MM_SHUFFLE(1, 0, 1, 0));
+	__m512 high01 = _mm512_shuffle_f32x4(l0, l1, _MM_SHUFFLE(3, 2, 3, 2));
+	__m512 high23 = _mm512_shuffle_f32x4(l2, l3, _MM_SHUFFLE(3, 2, 3, 2));
+
+	__m512 r0 = _mm512_shuffle_f32x4(low01, low23, _MM_SHUFFLE(2, 0, 2, 0));
+	__m512 r1 = _mm512_shuffle_f32x4(low01, low23, _MM_SHUFFLE(3, 1, 3, 1));
+	__m512 r2 = _mm512_shuffle_f32x4(high01, high23, _MM_SHUFFLE(2, 0, 2, 0));
+	__m512 r3 = _mm512_shuffle_f32x4(high01, high23, _MM_SHUFFLE(3, 1, 3, 1));
+
+	__m512 t0 = _mm512_unpacklo_ps(r0, r1);
+	__m512 t1 = _mm512_unpackhi_ps(r0, r1);
+	__m512 t2 = _mm512_unpacklo_ps(r2, r3);
+	__m512 t3 = _mm512_unpackhi_ps(r2, r3);
+
+	a = _mm512_shuffle_ps(t0, t2, 0x44);
+	b = _mm512_shuffle_ps(t0, t2, 0xEE);
+	c = _mm512_shuffle_ps(t1, t3, 0x44);
+	d = _mm512_shuffle_ps(t1, t3, 0xEE);
+}
+
+SIMD_NAMESPACE_END
+
+#endif //FEMFORANDROID_SCALARF16_AVX512_H
@@ -0,0 +1,215 @@
+#ifndef FEMFORANDROID_SCALARF4_NEON_H
+#define FEMFORANDROID_SCALARF4_NEON_H
+
+#include <arm_neon.h>
+
+SIMD_NAMESPACE_BEGIN
+
+// ----------------------------------------------------------------------------------------------
+//vector of 4 float values to represent 4 scalars
+class Scalarf4
+{
+public:
+	static const int WIDTH = 4;
+
+	float32x4_t v;
+
+	Scalarf4() {}
+
+	Scalarf4(float f) {
+		v = vdupq_n_f32(f);
+	}
+
+	Scalarf4(float f0, float f1, float f2, float f3) {
+		float __attribute__((aligned(16))) data[4] = { f0, f1, f2, f3 };
+		v = vld1q_f32(data);
+	}
+
+	Scalarf4(float32x4_t const & x) {
+		v = x;
+	}
+
+	Scalarf4 & operator = (float32x4_t const & x) {
+		v = x;
+		return *this;
+	}
+
+	Scalarf4& load(float const * p) {
+		v = vld1q_f32(p);
+		return *this;
+	}
+	
+	//lane i gets base[index[i]]
+	Scalarf4& gather(float const * base, int32_t const * index) {
+		*this = Scalarf4(base[index[0]], base[index[1]], base[index[2]], base[index[3]]);
+		return *this;
+	}
+
+	void store(float * p) const {
+		vst1q_f32(p, v);
+	}
+};
+
+static inline Scalarf4 operator + (Scalarf4 const & a, Scalarf4 const & b) {
+	return vaddq_f32(a.v, b.v);
+}
+
+static inline Scalarf4 & operator += (Scalarf4 & a, Scalarf4 const & b) {
+	a.v = vaddq_f32(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf4 operator - (Scalarf4 const & a, Scalarf4 const & b) {
+	return vsubq_f32(a.v, b.v);
+}
+
+static inline Scalarf4 & operator -= (Scalarf4 & a, Scalarf4 const & b) {
+	a.v = vsubq_f32(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf4 operator * (Scalarf4 const & a, Scalarf4 const & b) {
+	return vmulq_f32(a.v, b.v);
+}
+
+static inline Scalarf4 & operator *= (Scalarf4 & a, Scalarf4 const & b) {
+	a.v = vmulq_f32(a.v, b.v);
+	return a;
+}
+
+//AArch64 has a true division, ARMv7 refines a reciprocal estimate with two Newton-Raphson steps
+static inline Scalarf4 operator / (Scalarf4 const & a, Scalarf4 const & b) {
+#ifdef __aarch64__
+	return vdivq_f32(a.v, b.v);
+#else
+    float32x4_t recip = vrecpeq_f32(b.v);
+
+    recip = vmulq_f32(recip, vrecpsq_f32(recip, b.v));
+    recip = vmulq_f32(recip, vrecpsq_f32(recip, b.v));
+
+    return vmulq_f32(a.v, recip);
+#endif
+}
+
+//a + b * c, fused on AArch64. ARMv7 NEON only has the multiply-accumulate that rounds the product
+static inline Scalarf4 multiplyAdd(Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c) {
+#ifdef __aarch64__
+	return vfmaq_f32(a.v, b.v, c.v);
+#else
+	return vmlaq_f32(a.v, b.v, c.v);
+#endif
+}
+
+//a - b * c
+static inline Scalarf4 multiplySub(Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c) {
+#ifdef __aarch64__
+	return vfmsq_f32(a.v, b.v, c.v);
+#else
+	return vmlsq_f32(a.v, b.v, c.v);
+#endif
+}
+
+//the comparisons return masks, reinterpreted as floats so that they combine with & and | and feed blend
+static inline Scalarf4 operator == (Scalarf4 const & a, Scalarf4 const & b) {
+	return vreinterpretq_f32_u32(vceqq_f32(a.v, b.v));
+}
+
+static inline Scalarf4 operator != (Scalarf4 const & a, Scalarf4 const & b) {
+	return vreinterpretq_f32_u32(vmvnq_u32(vceqq_f32(a.v, b.v)));
+}
+
+static inline Scalarf4 operator < (Scalarf4 const & a, Scalarf4 const & b) {
+	return vreinterpretq_f32_u32(vcltq_f32(a.v, b.v));
+}
+
+static inline Scalarf4 operator <= (Scalarf4 const & a, Scalarf4 const & b) {
+	return vreinterpretq_f32_u32(vcleq_f32(a.v, b.v));
+}
+
+static inline Scalarf4 operator > (Scalarf4 const & a, Scalarf4 const & b) {
+	return vreinterpretq_f32_u32(vcgtq_f32(a.v, b.v));
+}
+
+static inline Scalarf4 operator >= (Scalarf4 const & a, Scalarf4 const & b) {
+	return vreinterpretq_f32_u32(vcgeq_f32(a.v, b.v));
+}
+
+static inline Scalarf4 abs(Scalarf4 const & a) {
+	return vabsq_f32(a.v);
+}
+
+static inline Scalarf4 min(Scalarf4 const & a, Scalarf4 const & b) {
+	return vminq_f32(a.v, b.v);
+}
+
+static inline Scalarf4 max(Scalarf4 const & a, Scalarf4 const & b) {
+	return vmaxq_f32(a.v, b.v);
+}
+
+//1 / sqrt(a), on ARMv7 an approximation refined with two Newton-Raphson steps
+static inline Scalarf4 rsqrt(Scalarf4 const & a) {
+#ifdef __aarch64__
+	return vdivq_f32(vdupq_n_f32(1.0f), vsqrtq_f32(a.v));
+#else
+	float32x4_t e = vrsqrteq_f32(a.v);
+
+	e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(a.v, e), e));
+	e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(a.v, e), e));
+
+	return e;
+#endif
+}
+
+//logical operations on the masks returned by the comparisons
+static inline Scalarf4 operator & (Scalarf4 const & a, Scalarf4 const & b) {
+	return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)));
+}
+
+static inline Scalarf4 operator | (Scalarf4 const & a, Scalarf4 const & b) {
+	return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)));
+}
+
+//true if any element of the mask is set
+static inline bool any(Scalarf4 const & c) {
+	uint32x4_t m = vreinterpretq_u32_f32(c.v);
+	uint32x2_t t = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+	return vget_lane_u32(vpmax_u32(t, t), 0) != 0;
+}
+
+//does the same as for (int i = 0; i < 4; i++) result[i] = c[i] ? a[i] : b[i];
+//the elemets in c must be either 0 (false) or 0xFFFFFFFF (true)
+static inline Scalarf4 blend(Scalarf4 const & c, Scalarf4 const & a, Scalarf4 const & b) {
+	return vbslq_f32(vreinterpretq_u32_f32(c.v), a.v, b.v);
+}
+
+//stores 4 vectors interleaved, p[4 * i + j] gets lane i of the j-th vector.
+//turns 4 lanes of x, y and z coordinates into 4 consecutive (x, y, z, w) vectors
+static inline void storeInterleaved(float * p, Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c, Scalarf4 const & d) {
+	float32x4x4_t v = { { a.v, b.v, c.v, d.v } };
+	vst4q_f32(p, v);
+}
+
+//storeInterleaved into registers, lanes[i] gets lane i of a, b, c and d
+static inline void interleave(Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c, Scalarf4 const & d, Scalarf4 (&lanes)[4]) {
+	float32x4x2_t ac = vzipq_f32(a.v, c.v);	//a0 c0 a1 c1, a2 c2 a3 c3
+	float32x4x2_t bd = vzipq_f32(b.v, d.v);
+	float32x4x2_t low = vzipq_f32(ac.val[0], bd.val[0]);
+	float32x4x2_t high = vzipq_f32(ac.val[1], bd.val[1]);
+	lanes[0] = low.val[0];
+	lanes[1] = low.val[1];
+	lanes[2] = high.val[0];
+	lanes[3] = high.val[1];
+}
+
+//inverse of storeInterleaved, lane i of the j-th vector gets p[4 * i + j]
+static inline void loadInterleaved(float const * p, Scalarf4 & a, Scalarf4 & b, Scalarf4 & c, Scalarf4 & d) {
+	float32x4x4_t v = vld4q_f32(p);
+	a = v.val[0];
+	b = v.val[1];
+	c = v.val[2];
+	d = v.val[3];
+}
+
+SIMD_NAMESPACE_END
+
+#endif //FEMFORANDROID_SCALARF4_NEON_H
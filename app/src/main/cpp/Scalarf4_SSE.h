@@ -0,0 +1,204 @@
+#ifndef FEMFORANDROID_SCALARF4_SSE_H
+#define FEMFORANDROID_SCALARF4_SSE_H
+
+#include <stdint.h>
+#include <smmintrin.h>
+
+SIMD_NAMESPACE_BEGIN
+
+// ----------------------------------------------------------------------------------------------
+//vector of 4 float values to represent 4 scalars, SSE4.1 counterpart of Scalarf4_NEON.h
+class Scalarf4
+{
+public:
+	static const int WIDTH = 4;
+
+	__m128 v;
+
+	Scalarf4() {}
+
+	Scalarf4(float f) {
+		v = _mm_set1_ps(f);
+	}
+
+	Scalarf4(float f0, float f1, float f2, float f3) {
+		v = _mm_setr_ps(f0, f1, f2, f3);
+	}
+
+	Scalarf4(__m128 const & x) {
+		v = x;
+	}
+
+	Scalarf4 & operator = (__m128 const & x) {
+		v = x;
+		return *this;
+	}
+
+	//like vld1q_f32 the pointer does not have to be aligned
+	Scalarf4& load(float const * p) {
+		v = _mm_loadu_ps(p);
+		return *this;
+	}
+
+	//lane i gets base[index[i]]
+	Scalarf4& gather(float const * base, int32_t const * index) {
+		*this = Scalarf4(base[index[0]], base[index[1]], base[index[2]], base[index[3]]);
+		return *this;
+	}
+
+	void store(float * p) const {
+		_mm_storeu_ps(p, v);
+	}
+};
+
+static inline Scalarf4 operator + (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_add_ps(a.v, b.v);
+}
+
+static inline Scalarf4 & operator += (Scalarf4 & a, Scalarf4 const & b) {
+	a.v = _mm_add_ps(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf4 operator - (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_sub_ps(a.v, b.v);
+}
+
+static inline Scalarf4 & operator -= (Scalarf4 & a, Scalarf4 const & b) {
+	a.v = _mm_sub_ps(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf4 operator * (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_mul_ps(a.v, b.v);
+}
+
+static inline Scalarf4 & operator *= (Scalarf4 & a, Scalarf4 const & b) {
+	a.v = _mm_mul_ps(a.v, b.v);
+	return a;
+}
+
+//x86 has a real division, it is exact where NEON refines a reciprocal estimate
+static inline Scalarf4 operator / (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_div_ps(a.v, b.v);
+}
+
+//a + b * c, fused where the unit is built with FMA (the AVX2 and AVX-512 kernels)
+static inline Scalarf4 multiplyAdd(Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c) {
+#ifdef __FMA__
+	return _mm_fmadd_ps(b.v, c.v, a.v);
+#else
+	return _mm_add_ps(a.v, _mm_mul_ps(b.v, c.v));
+#endif
+}
+
+//a - b * c
+static inline Scalarf4 multiplySub(Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c) {
+#ifdef __FMA__
+	return _mm_fnmadd_ps(b.v, c.v, a.v);
+#else
+	return _mm_sub_ps(a.v, _mm_mul_ps(b.v, c.v));
+#endif
+}
+
+static inline Scalarf4 operator == (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_cmpeq_ps(a.v, b.v);
+}
+
+static inline Scalarf4 operator != (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_cmpneq_ps(a.v, b.v);
+}
+
+static inline Scalarf4 operator < (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_cmplt_ps(a.v, b.v);
+}
+
+static inline Scalarf4 operator <= (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_cmple_ps(a.v, b.v);
+}
+
+static inline Scalarf4 operator > (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_cmpgt_ps(a.v, b.v);
+}
+
+static inline Scalarf4 operator >= (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_cmpge_ps(a.v, b.v);
+}
+
+static inline Scalarf4 abs(Scalarf4 const & a) {
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v);
+}
+
+static inline Scalarf4 min(Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_min_ps(a.v, b.v);
+}
+
+static inline Scalarf4 max(Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_max_ps(a.v, b.v);
+}
+
+//approximation of 1 / sqrt(a) refined with one Newton-Raphson step, the estimate is more precise than on NEON
+static inline Scalarf4 rsqrt(Scalarf4 const & a) {
+
+	__m128 e = _mm_rsqrt_ps(a.v);
+
+	e = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), e),
+				   _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(a.v, e), e)));
+
+	return e;
+}
+
+//logical operations on the masks returned by the comparisons
+static inline Scalarf4 operator & (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_and_ps(a.v, b.v);
+}
+
+static inline Scalarf4 operator | (Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_or_ps(a.v, b.v);
+}
+
+//true if any element of the mask is set
+static inline bool any(Scalarf4 const & c) {
+	return _mm_movemask_ps(c.v) != 0;
+}
+
+//does the same as for (int i = 0; i < 4; i++) result[i] = c[i] ? a[i] : b[i];
+//the elemets in c must be either 0 (false) or 0xFFFFFFFF (true)
+static inline Scalarf4 blend(Scalarf4 const & c, Scalarf4 const & a, Scalarf4 const & b) {
+	return _mm_blendv_ps(b.v, a.v, c.v);
+}
+
+//stores 4 vectors interleaved, p[4 * i + j] gets lane i of the j-th vector.
+//turns 4 lanes of x, y and z coordinates into 4 consecutive (x, y, z, w) vectors
+static inline void storeInterleaved(float * p, Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c, Scalarf4 const & d) {
+	__m128 r0 = a.v, r1 = b.v, r2 = c.v, r3 = d.v;
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(p, r0);
+	_mm_storeu_ps(p + 4, r1);
+	_mm_storeu_ps(p + 8, r2);
+	_mm_storeu_ps(p + 12, r3);
+}
+
+//storeInterleaved into registers, lanes[i] gets lane i of a, b, c and d
+static inline void interleave(Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c, Scalarf4 const & d, Scalarf4 (&lanes)[4]) {
+	__m128 r0 = a.v, r1 = b.v, r2 = c.v, r3 = d.v;
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	lanes[0] = r0;
+	lanes[1] = r1;
+	lanes[2] = r2;
+	lanes[3] = r3;
+}
+
+//inverse of storeInterleaved, lane i of the j-th vector gets p[4 * i + j]
+static inline void loadInterleaved(float const * p, Scalarf4 & a, Scalarf4 & b, Scalarf4 & c, Scalarf4 & d) {
+	__m128 r0 = _mm_loadu_ps(p), r1 = _mm_loadu_ps(p + 4), r2 = _mm_loadu_ps(p + 8), r3 = _mm_loadu_ps(p + 12);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	a = r0;
+	b = r1;
+	c = r2;
+	d = r3;
+}
+
+SIMD_NAMESPACE_END
+
+#endif //FEMFORANDROID_SCALARF4_SSE_H
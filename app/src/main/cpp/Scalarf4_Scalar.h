@@ -0,0 +1,194 @@
+#ifndef FEMFORANDROID_SCALARF4_SCALAR_H
+#define FEMFORANDROID_SCALARF4_SCALAR_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+SIMD_NAMESPACE_BEGIN
+
+// ----------------------------------------------------------------------------------------------
+//vector of 4 float values to represent 4 scalars in plain C++, counterpart of Scalarf4_NEON.h
+//for CPUs without a supported vector unit. the compiler may still vectorize the loops
+class Scalarf4
+{
+public:
+	static const int WIDTH = 4;
+
+	float v[4];
+
+	Scalarf4() {}
+
+	Scalarf4(float f) {
+		v[0] = v[1] = v[2] = v[3] = f;
+	}
+
+	Scalarf4(float f0, float f1, float f2, float f3) {
+		v[0] = f0; v[1] = f1; v[2] = f2; v[3] = f3;
+	}
+
+	Scalarf4& load(float const * p) {
+		for (int i = 0; i < 4; i++) v[i] = p[i];
+		return *this;
+	}
+
+	//lane i gets base[index[i]]
+	Scalarf4& gather(float const * base, int32_t const * index) {
+		for (int i = 0; i < 4; i++) v[i] = base[index[i]];
+		return *this;
+	}
+
+	void store(float * p) const {
+		for (int i = 0; i < 4; i++) p[i] = v[i];
+	}
+};
+
+//masks have all bits of an element set or cleared like the ones of the vector units
+static inline float scalarMask(bool b) {
+	uint32_t bits = b ? 0xFFFFFFFFu : 0u;
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static inline uint32_t scalarBits(float f) {
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+static inline Scalarf4 operator + (Scalarf4 const & a, Scalarf4 const & b) {
+	return Scalarf4(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]);
+}
+
+static inline Scalarf4 & operator += (Scalarf4 & a, Scalarf4 const & b) {
+	a = a + b;
+	return a;
+}
+
+static inline Scalarf4 operator - (Scalarf4 const & a, Scalarf4 const & b) {
+	return Scalarf4(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]);
+}
+
+static inline Scalarf4 & operator -= (Scalarf4 & a, Scalarf4 const & b) {
+	a = a - b;
+	return a;
+}
+
+static inline Scalarf4 operator * (Scalarf4 const & a, Scalarf4 const & b) {
+	return Scalarf4(a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]);
+}
+
+static inline Scalarf4 & operator *= (Scalarf4 & a, Scalarf4 const & b) {
+	a = a * b;
+	return a;
+}
+
+static inline Scalarf4 operator / (Scalarf4 const & a, Scalarf4 const & b) {
+	return Scalarf4(a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]);
+}
+
+//a + b * c
+static inline Scalarf4 multiplyAdd(Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c) {
+	return a + b * c;
+}
+
+//a - b * c
+static inline Scalarf4 multiplySub(Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c) {
+	return a - b * c;
+}
+
+#define SCALARF4_COMPARISON(op) \
+	static inline Scalarf4 operator op (Scalarf4 const & a, Scalarf4 const & b) { \
+		return Scalarf4(scalarMask(a.v[0] op b.v[0]), scalarMask(a.v[1] op b.v[1]), \
+						scalarMask(a.v[2] op b.v[2]), scalarMask(a.v[3] op b.v[3])); \
+	}
+
+SCALARF4_COMPARISON(==)
+SCALARF4_COMPARISON(!=)
+SCALARF4_COMPARISON(<)
+SCALARF4_COMPARISON(<=)
+SCALARF4_COMPARISON(>)
+SCALARF4_COMPARISON(>=)
+
+#undef SCALARF4_COMPARISON
+
+static inline Scalarf4 abs(Scalarf4 const & a) {
+	return Scalarf4(fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3]));
+}
+
+static inline Scalarf4 min(Scalarf4 const & a, Scalarf4 const & b) {
+	return Scalarf4(fminf(a.v[0], b.v[0]), fminf(a.v[1], b.v[1]), fminf(a.v[2], b.v[2]), fminf(a.v[3], b.v[3]));
+}
+
+static inline Scalarf4 max(Scalarf4 const & a, Scalarf4 const & b) {
+	return Scalarf4(fmaxf(a.v[0], b.v[0]), fmaxf(a.v[1], b.v[1]), fmaxf(a.v[2], b.v[2]), fmaxf(a.v[3], b.v[3]));
+}
+
+//exact here, the vector units refine an estimate
+static inline Scalarf4 rsqrt(Scalarf4 const & a) {
+	return Scalarf4(1.0f / sqrtf(a.v[0]), 1.0f / sqrtf(a.v[1]), 1.0f / sqrtf(a.v[2]), 1.0f / sqrtf(a.v[3]));
+}
+
+//logical operations on the masks returned by the comparisons
+static inline Scalarf4 operator & (Scalarf4 const & a, Scalarf4 const & b) {
+	Scalarf4 result;
+	for (int i = 0; i < 4; i++) {
+		uint32_t bits = scalarBits(a.v[i]) & scalarBits(b.v[i]);
+		memcpy(&result.v[i], &bits, sizeof(bits));
+	}
+	return result;
+}
+
+static inline Scalarf4 operator | (Scalarf4 const & a, Scalarf4 const & b) {
+	Scalarf4 result;
+	for (int i = 0; i < 4; i++) {
+		uint32_t bits = scalarBits(a.v[i]) | scalarBits(b.v[i]);
+		memcpy(&result.v[i], &bits, sizeof(bits));
+	}
+	return result;
+}
+
+//true if any element of the mask is set
+static inline bool any(Scalarf4 const & c) {
+	return (scalarBits(c.v[0]) | scalarBits(c.v[1]) | scalarBits(c.v[2]) | scalarBits(c.v[3])) != 0;
+}
+
+//does the same as for (int i = 0; i < 4; i++) result[i] = c[i] ? a[i] : b[i];
+//the elemets in c must be either 0 (false) or 0xFFFFFFFF (true)
+static inline Scalarf4 blend(Scalarf4 const & c, Scalarf4 const & a, Scalarf4 const & b) {
+	Scalarf4 result;
+	for (int i = 0; i < 4; i++)
+		result.v[i] = scalarBits(c.v[i]) ? a.v[i] : b.v[i];
+	return result;
+}
+
+//stores 4 vectors interleaved, p[4 * i + j] gets lane i of the j-th vector
+static inline void storeInterleaved(float * p, Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c, Scalarf4 const & d) {
+	for (int i = 0; i < 4; i++) {
+		p[4 * i] = a.v[i];
+		p[4 * i + 1] = b.v[i];
+		p[4 * i + 2] = c.v[i];
+		p[4 * i + 3] = d.v[i];
+	}
+}
+
+//storeInterleaved into registers, lanes[i] gets lane i of a, b, c and d
+static inline void interleave(Scalarf4 const & a, Scalarf4 const & b, Scalarf4 const & c, Scalarf4 const & d, Scalarf4 (&lanes)[4]) {
+	for (int i = 0; i < 4; i++)
+		lanes[i] = Scalarf4(a.v[i], b.v[i], c.v[i], d.v[i]);
+}
+
+//inverse of storeInterleaved, lane i of the j-th vector gets p[4 * i + j]
+static inline void loadInterleaved(float const * p, Scalarf4 & a, Scalarf4 & b, Scalarf4 & c, Scalarf4 & d) {
+	for (int i = 0; i < 4; i++) {
+		a.v[i] = p[4 * i];
+		b.v[i] = p[4 * i + 1];
+		c.v[i] = p[4 * i + 2];
+		d.v[i] = p[4 * i + 3];
+	}
+}
+
+SIMD_NAMESPACE_END
+
+#endif //FEMFORANDROID_SCALARF4_SCALAR_H
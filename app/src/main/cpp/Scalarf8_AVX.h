@@ -0,0 +1,218 @@
+#ifndef FEMFORANDROID_SCALARF8_AVX_H
+#define FEMFORANDROID_SCALARF8_AVX_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+SIMD_NAMESPACE_BEGIN
+
+// ----------------------------------------------------------------------------------------------
+//vector of 8 float values to represent 8 scalars, AVX2 counterpart of Scalarf4
+class Scalarf8
+{
+public:
+	static const int WIDTH = 8;
+
+	__m256 v;
+
+	Scalarf8() {}
+
+	Scalarf8(float f) {
+		v = _mm256_set1_ps(f);
+	}
+
+	Scalarf8(float f0, float f1, float f2, float f3, float f4, float f5, float f6, float f7) {
+		v = _mm256_setr_ps(f0, f1, f2, f3, f4, f5, f6, f7);
+	}
+
+	Scalarf8(__m256 const & x) {
+		v = x;
+	}
+
+	Scalarf8 & operator = (__m256 const & x) {
+		v = x;
+		return *this;
+	}
+
+	Scalarf8& load(float const * p) {
+		v = _mm256_loadu_ps(p);
+		return *this;
+	}
+
+	//lane i gets base[index[i]], one gather instruction instead of 8 loads
+	Scalarf8& gather(float const * base, int32_t const * index) {
+		v = _mm256_i32gather_ps(base, _mm256_loadu_si256((__m256i const *) index), 4);
+		return *this;
+	}
+
+	void store(float * p) const {
+		_mm256_storeu_ps(p, v);
+	}
+};
+
+static inline Scalarf8 operator + (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_add_ps(a.v, b.v);
+}
+
+static inline Scalarf8 & operator += (Scalarf8 & a, Scalarf8 const & b) {
+	a.v = _mm256_add_ps(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf8 operator - (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_sub_ps(a.v, b.v);
+}
+
+static inline Scalarf8 & operator -= (Scalarf8 & a, Scalarf8 const & b) {
+	a.v = _mm256_sub_ps(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf8 operator * (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_mul_ps(a.v, b.v);
+}
+
+static inline Scalarf8 & operator *= (Scalarf8 & a, Scalarf8 const & b) {
+	a.v = _mm256_mul_ps(a.v, b.v);
+	return a;
+}
+
+static inline Scalarf8 operator / (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_div_ps(a.v, b.v);
+}
+
+//a + b * c
+static inline Scalarf8 multiplyAdd(Scalarf8 const & a, Scalarf8 const & b, Scalarf8 const & c) {
+	return _mm256_fmadd_ps(b.v, c.v, a.v);
+}
+
+//a - b * c
+static inline Scalarf8 multiplySub(Scalarf8 const & a, Scalarf8 const & b, Scalarf8 const & c) {
+	return _mm256_fnmadd_ps(b.v, c.v, a.v);
+}
+
+static inline Scalarf8 operator == (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ);
+}
+
+static inline Scalarf8 operator != (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ);
+}
+
+static inline Scalarf8 operator < (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ);
+}
+
+static inline Scalarf8 operator <= (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ);
+}
+
+static inline Scalarf8 operator > (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ);
+}
+
+static inline Scalarf8 operator >= (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ);
+}
+
+static inline Scalarf8 abs(Scalarf8 const & a) {
+	return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v);
+}
+
+static inline Scalarf8 min(Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_min_ps(a.v, b.v);
+}
+
+static inline Scalarf8 max(Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_max_ps(a.v, b.v);
+}
+
+//approximation of 1 / sqrt(a) refined with one Newton-Raphson step, as in Scalarf4_SSE.h
+static inline Scalarf8 rsqrt(Scalarf8 const & a) {
+
+	__m256 e = _mm256_rsqrt_ps(a.v);
+
+	e = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), e),
+					  _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_mul_ps(a.v, e), e)));
+
+	return e;
+}
+
+//logical operations on the masks returned by the comparisons
+static inline Scalarf8 operator & (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_and_ps(a.v, b.v);
+}
+
+static inline Scalarf8 operator | (Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_or_ps(a.v, b.v);
+}
+
+//true if any element of the mask is set
+static inline bool any(Scalarf8 const & c) {
+	return _mm256_movemask_ps(c.v) != 0;
+}
+
+//does the same as for (int i = 0; i < 8; i++) result[i] = c[i] ? a[i] : b[i];
+//the elemets in c must be either 0 (false) or 0xFFFFFFFF (true)
+static inline Scalarf8 blend(Scalarf8 const & c, Scalarf8 const & a, Scalarf8 const & b) {
+	return _mm256_blendv_ps(b.v, a.v, c.v);
+}
+
+//stores 4 vectors interleaved, p[4 * i + j] gets lane i of the j-th vector.
+//the 4x4 transposes run within the 128 bit halves, lanes 0-3 come from the low and 4-7 from the high halves
+static inline void storeInterleaved(float * p, Scalarf8 const & a, Scalarf8 const & b, Scalarf8 const & c, Scalarf8 const & d) {
+	__m256 t0 = _mm256_unpacklo_ps(a.v, b.v);
+	__m256 t1 = _mm256_unpackhi_ps(a.v, b.v);
+	__m256 t2 = _mm256_unpacklo_ps(c.v, d.v);
+	__m256 t3 = _mm256_unpackhi_ps(c.v, d.v);
+
+	__m256 r0 = _mm256_shuffle_ps(t0, t2, 0x44);	//lanes 0 and 4
+	__m256 r1 = _mm256_shuffle_ps(t0, t2, 0xEE);	//lanes 1 and 5
+	__m256 r2 = _mm256_shuffle_ps(t1, t3, 0x44);	//lanes 2 and 6
+	__m256 r3 = _mm256_shuffle_ps(t1, t3, 0xEE);	//lanes 3 and 7
+
+	_mm256_storeu_ps(p, _mm256_permute2f128_ps(r0, r1, 0x20));
+	_mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(r2, r3, 0x20));
+	_mm256_storeu_ps(p + 16, _mm256_permute2f128_ps(r0, r1, 0x31));
+	_mm256_storeu_ps(p + 24, _mm256_permute2f128_ps(r2, r3, 0x31));
+}
+
+//storeInterleaved into registers, lanes[i] gets lane i of a, b, c and d as a vector of Scalarf4
+static inline void interleave(Scalarf8 const & a, Scalarf8 const & b, Scalarf8 const & c, Scalarf8 const & d, Scalarf4 (&lanes)[8]) {
+	__m256 t0 = _mm256_unpacklo_ps(a.v, b.v);
+	__m256 t1 = _mm256_unpackhi_ps(a.v, b.v);
+	__m256 t2 = _mm256_unpacklo_ps(c.v, d.v);
+	__m256 t3 = _mm256_unpackhi_ps(c.v, d.v);
+
+	__m256 r[4] = { _mm256_shuffle_ps(t0, t2, 0x44), _mm256_shuffle_ps(t0, t2, 0xEE),
+		_mm256_shuffle_ps(t1, t3, 0x44), _mm256_shuffle_ps(t1, t3, 0xEE) };
+
+	for (int i = 0; i < 4; i++) {
+		lanes[i] = _mm256_castps256_ps128(r[i]);
+		lanes[i + 4] = _mm256_extractf128_ps(r[i], 1);
+	}
+}
+
+//inverse of storeInterleaved, lane i of the j-th vector gets p[4 * i + j]
+static inline void loadInterleaved(float const * p, Scalarf8 & a, Scalarf8 & b, Scalarf8 & c, Scalarf8 & d) {
+	__m256 l0 = _mm256_loadu_ps(p), l1 = _mm256_loadu_ps(p + 8), l2 = _mm256_loadu_ps(p + 16), l3 = _mm256_loadu_ps(p + 24);
+
+	__m256 r0 = _mm256_permute2f128_ps(l0, l2, 0x20);	//lanes 0 and 4
+	__m256 r1 = _mm256_permute2f128_ps(l0, l2, 0x31);	//lanes 1 and 5
+	__m256 r2 = _mm256_permute2f128_ps(l1, l3, 0x20);	//lanes 2 and 6
+	__m256 r3 = _mm256_permute2f128_ps(l1, l3, 0x31);	//lanes 3 and 7
+
+	__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+	__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+	__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+	__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+
+	a = _mm256_shuffle_ps(t0, t2, 0x44);
+	b = _mm256_shuffle_ps(t0, t2, 0xEE);
+	c = _mm256_shuffle_ps(t1, t3, 0x44);
+	d = _mm256_shuffle_ps(t1, t3, 0xEE);
+}
+
+SIMD_NAMESPACE_END
+
+#endif //FEMFORANDROID_SCALARF8_AVX_H
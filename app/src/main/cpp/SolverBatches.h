@@ -0,0 +1,134 @@
+#ifndef FEMFORANDROID_SOLVER_BATCHES_H
+#define FEMFORANDROID_SOLVER_BATCHES_H
+
+#include <stdint.h>
+
+// records of the batched solver and the interface of its kernels. the records are plain float arrays
+// of W lanes, so they only depend on the lane width and not on the vector type the kernels use
+
+//constants and state of the local step for W tets, lane j of batch i belongs to tet W * i + j.
+//padding lanes of the last batch repeat the last tet
+template <int W>
+struct alignas(4 * W) TetBatch {
+    float DT[4][3][W];	//D_t^T
+    float K[W];	//2 * dt * dt * mu * rest volume
+    float quat[4][W];	//rotation of the last substep as (x, y, z, w), initial guess of the APD
+    int32_t indices[4][W];	//[corner][lane]
+};
+
+//constants and state of W volume constraints of the same phase
+template <int W>
+struct alignas(4 * W) ConstraintBatch {
+    float invMass[4][W];	//per corner
+    float restVolume[W];
+    float alpha[W];
+    float kappa[W];
+    int32_t indices[4][W];	//[corner][lane]
+};
+
+//constants of one tet of a shape simulated as instances, shared by all of them. indices are vertices of the shape
+struct InstancedTet {
+    float DT[4][3];	//D_t^T
+    float K;	//2 * dt * dt * mu * rest volume
+    float invMass[4];	//per corner
+    float restVolume;
+    float alpha;
+    int32_t indices[4];
+};
+
+//the bodies of one shape simulated as instances of it. vertex v of instance k is vertex v * instanceCount + k
+//of the group, so the same vertex of W consecutive instances is contiguous and W instances of a tet fill a vector.
+//only the state is per instance, lane k of the state of a tet belongs to instance k
+struct InstanceGroupData {
+    //first vertex of the group in the positions and the RHS
+    unsigned int vertexOffset;
+    int instanceCount;
+    //instances rounded up to the lane width, the stride of the state
+    int instanceStride;
+
+    //tets of the shape in the order of its constraint phases
+    unsigned int tetCount;
+    const InstancedTet* tets;
+
+    float* quat;	//[tet][4][instanceStride], rotation of the last substep as (x, y, z, w)
+    float* kappa;	//[tet][instanceStride]
+};
+
+//what the kernels work on, all of it belongs to Physics. the batch pointers point to records of the lane width of the kernels
+struct KernelData {
+    //positions of the solver
+    float* x;
+    float* y;
+    float* z;
+
+    unsigned int tetCount;
+    void* tetBatches;
+    void* constraintBatches;
+    //the volume constraints once more in the order of the tet batches for the Jacobi mode
+    void* jacobiBatches;
+
+    //one (x, y, z, 0) entry per batch, corner and lane, entry (4 * i + k) * W + j belongs to corner k of tet W * i + j
+    float* staging;
+
+    //constraint batches [phaseBatchOffsets[i], phaseBatchOffsets[i + 1]) form phase i of phaseSizes[i] constraints
+    const int* phaseBatchOffsets;
+    const int* phaseSizes;
+};
+
+//rows of one substitution of the triangular solve, see TriangularSolver.h
+struct TriangularEntry {
+    int index;
+    float value;
+};
+
+struct TriangularRows {
+    const int* offsets;     //rows + 1, range of the row in entries
+    const int* targets;     //original index of the unknown solved by the row
+    const float* invDiagonal;
+    const TriangularEntry* entries;
+};
+
+//instruction sets the kernels are built for, see KernelDispatch.h
+enum KernelInstructionSet {
+    //the best one the CPU supports
+    AutoKernels,
+    ScalarKernels,
+    SSE4Kernels,
+    AVX2Kernels,
+    AVX512Kernels,
+    NEONKernels
+};
+
+//the kernels of one vector type, see SolverKernels.h. rhs holds one (x, y, z, 0) entry per vertex
+struct SolverKernelTable {
+    const char* name;
+    KernelInstructionSet instructionSet;
+    int laneWidth;
+
+    //local step of the tet batches [batchBegin, batchEnd), the contributions are added to rhs
+    //or written to the staging area if rhs is null
+    void (*localStep)(const KernelData& data, int batchBegin, int batchEnd, float* rhs);
+    //the same in separate passes, all contributions go to the staging area before they are added to rhs
+    void (*localStepSplit)(const KernelData& data, int batchBegin, int batchEnd, float* rhs);
+    //Gauss-Seidel over the constraint batches [batchBegin, batchEnd) of a phase
+    void (*solveConstraints)(const KernelData& data, int phase, int batchBegin, int batchEnd);
+    //Jacobi updates of the batches [batchBegin, batchEnd) written to the staging area
+    void (*stageConstraints)(const KernelData& data, int batchBegin, int batchEnd);
+    //local step of the instances [instanceBegin, instanceEnd) of a group, instanceBegin is a multiple of the lane width.
+    //the contributions are added to rhs, which has to hold the entries of the group
+    void (*localStepInstanced)(const KernelData& data, const InstanceGroupData& group, int instanceBegin, int instanceEnd,
+            float* rhs);
+    //Gauss-Seidel over all constraints of the instances [instanceBegin, instanceEnd) of a group
+    void (*solveConstraintsInstanced)(const KernelData& data, const InstanceGroupData& group, int instanceBegin, int instanceEnd);
+    //rows [rowBegin, rowEnd) of a substitution, x holds one (x, y, z, 0) entry per unknown
+    void (*solveTriangularRows)(const TriangularRows& rows, float* x, int rowBegin, int rowEnd);
+    //the same for several right hand sides, x holds the entries of all instances of an unknown one after another
+    void (*solveTriangularRowsInstanced)(const TriangularRows& rows, float* x, int rowBegin, int rowEnd, int instances);
+    //microbenchmark of the multiply-accumulate expressions, see Physics::benchmarkExpressions. det(H) of the APD of the
+    //tet batches [batchBegin, batchEnd), W floats per batch, with multiplyAdd or with separate operators
+    void (*measureExpressions)(const KernelData& data, int batchBegin, int batchEnd, bool fused, float* determinants);
+    //the same in double precision
+    void (*referenceExpressions)(const KernelData& data, int batchBegin, int batchEnd, double* determinants);
+};
+
+#endif //FEMFORANDROID_SOLVER_BATCHES_H
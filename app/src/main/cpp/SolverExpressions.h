@@ -0,0 +1,122 @@
+#ifndef FEMFORANDROID_SOLVER_EXPRESSIONS_H
+#define FEMFORANDROID_SOLVER_EXPRESSIONS_H
+
+#include "NEON_math.h"
+#include "SolverBatches.h"
+
+SIMD_NAMESPACE_BEGIN
+
+// the deformation gradient and the Hessian determinant of the APD (for R = I) of the local step, written once and
+// evaluated either with multiplyAdd and multiplySub or with separate multiplications and additions.
+// the separate version is instantiated in SolverExpressions_*.cpp, which are built with -ffp-contract=off,
+// so the compiler does not fuse its a + b * c on its own. Physics::benchmarkExpressions compares the two
+template <class Scalar, bool fused>
+class SolverExpressions {
+public:
+    static const int W = Scalar::WIDTH;
+
+    typedef SIMDVector3<Scalar> Vector3;
+
+    //det(H) of the batches [batchBegin, batchEnd), W floats per batch
+    static void measure(const KernelData& data, int batchBegin, int batchEnd, float* determinants) {
+
+        TetBatch<W>* batches = (TetBatch<W>*) data.tetBatches;
+
+        for (int i = batchBegin; i < batchEnd; i++)
+        {
+            Scalar DT[4][3];
+            for (int j = 0; j < 4; j++)
+                for (int k = 0; k < 3; k++)
+                    DT[j][k].load(batches[i].DT[j][k]);
+
+            Vector3 vertices[4];
+            for (int j = 0; j < 4; j++)
+            {
+                vertices[j].x().gather(data.x, batches[i].indices[j]);
+                vertices[j].y().gather(data.y, batches[i].indices[j]);
+                vertices[j].z().gather(data.z, batches[i].indices[j]);
+            }
+
+            Vector3 F1 = vertices[0] * DT[0][0];
+            Vector3 F2 = vertices[0] * DT[0][1];
+            Vector3 F3 = vertices[0] * DT[0][2];
+
+            for (int j = 1; j < 4; j++)
+            {
+                F1 = add(F1, vertices[j], DT[j][0]);
+                F2 = add(F2, vertices[j], DT[j][1]);
+                F3 = add(F3, vertices[j], DT[j][2]);
+            }
+
+            Scalar h00 = F2[1] + F3[2];
+            Scalar h11 = F1[0] + F3[2];
+            Scalar h22 = F1[0] + F2[1];
+            Scalar h01 = Scalar(-0.5) * (F2[0] + F1[1]);
+            Scalar h02 = Scalar(-0.5) * (F3[0] + F1[2]);
+            Scalar h12 = Scalar(-0.5) * (F3[1] + F2[2]);
+
+            Scalar c00 = sub(h11 * h22, h12, h12);
+            Scalar c01 = sub(h02 * h12, h01, h22);
+            Scalar c02 = sub(h01 * h12, h02, h11);
+
+            Scalar detH = add(add(h00 * c00, h01, c01), h02, c02);
+            detH.store(determinants + (i - batchBegin) * W);
+        }
+    }
+
+    //the same in double precision from the same float inputs, the reference of both versions
+    static void reference(const KernelData& data, int batchBegin, int batchEnd, double* determinants) {
+
+        TetBatch<W>* batches = (TetBatch<W>*) data.tetBatches;
+
+        for (int i = batchBegin; i < batchEnd; i++)
+        {
+            for (int lane = 0; lane < W; lane++)
+            {
+                double F[3][3] = {};
+                for (int j = 0; j < 4; j++)
+                {
+                    const int v = batches[i].indices[j][lane];
+                    const double p[3] = { data.x[v], data.y[v], data.z[v] };
+
+                    for (int k = 0; k < 3; k++)
+                        for (int c = 0; c < 3; c++)
+                            F[k][c] += p[c] * batches[i].DT[j][k][lane];
+                }
+
+                double h00 = F[1][1] + F[2][2];
+                double h11 = F[0][0] + F[2][2];
+                double h22 = F[0][0] + F[1][1];
+                double h01 = -0.5 * (F[1][0] + F[0][1]);
+                double h02 = -0.5 * (F[2][0] + F[0][2]);
+                double h12 = -0.5 * (F[2][1] + F[1][2]);
+
+                determinants[(i - batchBegin) * W + lane] = h00 * (h11 * h22 - h12 * h12) +
+                        h01 * (h02 * h12 - h01 * h22) + h02 * (h01 * h12 - h02 * h11);
+            }
+        }
+    }
+
+private:
+    //a + b * c
+    static inline Scalar add(const Scalar& a, const Scalar& b, const Scalar& c) {
+        return fused ? multiplyAdd(a, b, c) : a + b * c;
+    }
+
+    //a - b * c
+    static inline Scalar sub(const Scalar& a, const Scalar& b, const Scalar& c) {
+        return fused ? multiplySub(a, b, c) : a - b * c;
+    }
+
+    static inline Vector3 add(const Vector3& a, const Vector3& b, const Scalar& s) {
+        return fused ? multiplyAdd(a, b, s) : a + b * s;
+    }
+};
+
+//defined in SolverExpressions_*.cpp, with the vector type of the kernels of the unit
+void measureSeparateExpressions(const KernelData& data, int batchBegin, int batchEnd, float* determinants);
+void measureReferenceExpressions(const KernelData& data, int batchBegin, int batchEnd, double* determinants);
+
+SIMD_NAMESPACE_END
+
+#endif //FEMFORANDROID_SOLVER_EXPRESSIONS_H
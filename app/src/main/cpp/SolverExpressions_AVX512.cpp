@@ -0,0 +1,15 @@
+// expressions of the benchmark with separate operators for the AVX-512 kernels, built with -mavx512f -mfma -ffp-contract=off
+#define SIMD_NAMESPACE avx512
+#include "SolverExpressions.h"
+
+SIMD_NAMESPACE_BEGIN
+
+void measureSeparateExpressions(const KernelData& data, int batchBegin, int batchEnd, float* determinants) {
+    SolverExpressions<Scalarf16, false>::measure(data, batchBegin, batchEnd, determinants);
+}
+
+void measureReferenceExpressions(const KernelData& data, int batchBegin, int batchEnd, double* determinants) {
+    SolverExpressions<Scalarf16, false>::reference(data, batchBegin, batchEnd, determinants);
+}
+
+SIMD_NAMESPACE_END
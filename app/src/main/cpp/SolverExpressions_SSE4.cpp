@@ -0,0 +1,15 @@
+// expressions of the benchmark with separate operators for the SSE4.1 kernels, built with -ffp-contract=off
+#define SIMD_NAMESPACE sse4
+#include "SolverExpressions.h"
+
+SIMD_NAMESPACE_BEGIN
+
+void measureSeparateExpressions(const KernelData& data, int batchBegin, int batchEnd, float* determinants) {
+    SolverExpressions<Scalarf4, false>::measure(data, batchBegin, batchEnd, determinants);
+}
+
+void measureReferenceExpressions(const KernelData& data, int batchBegin, int batchEnd, double* determinants) {
+    SolverExpressions<Scalarf4, false>::reference(data, batchBegin, batchEnd, determinants);
+}
+
+SIMD_NAMESPACE_END
@@ -0,0 +1,642 @@
+#ifndef FEMFORANDROID_SOLVER_KERNELS_H
+#define FEMFORANDROID_SOLVER_KERNELS_H
+
+#include <algorithm>
+
+#include "NEON_math.h"
+#include "SolverBatches.h"
+#include "SolverExpressions.h"
+
+SIMD_NAMESPACE_BEGIN
+
+// local step, volume constraint and triangular solve kernels written once for any vector type of NEON_math.h.
+// Scalar::WIDTH tets or constraints are processed at a time, reading the records of that lane width.
+// every instruction set compiles them in its own translation unit, the table returned by getTable
+// is how Physics calls them (see KernelDispatch.h)
+template <class Scalar>
+class SolverKernels {
+public:
+    static const int W = Scalar::WIDTH;
+
+    typedef SIMDVector3<Scalar> Vector3;
+    typedef SIMDMatrix3<Scalar> Matrix3;
+    typedef SIMDQuaternion<Scalar> Quaternion;
+
+    static SolverKernelTable getTable(KernelInstructionSet instructionSet, const char* name) {
+        SolverKernelTable table;
+        table.name = name;
+        table.instructionSet = instructionSet;
+        table.laneWidth = W;
+        table.localStep = &localStep;
+        table.localStepSplit = &localStepSplit;
+        table.solveConstraints = &solveConstraints;
+        table.stageConstraints = &stageConstraints;
+        table.localStepInstanced = &localStepInstanced;
+        table.solveConstraintsInstanced = &solveConstraintsInstanced;
+        table.solveTriangularRows = &solveTriangularRows;
+        table.solveTriangularRowsInstanced = &solveTriangularRowsInstanced;
+        table.measureExpressions = &measureExpressions;
+        table.referenceExpressions = &measureReferenceExpressions;
+        return table;
+    }
+
+private:
+    //the fused local step prefetches the vertices of the next batch and the record of the one after it
+    static const int PREFETCH_DISTANCE = 2;
+
+#if defined(__aarch64__) && !defined(SIMD_SCALAR)
+    //AArch64 has 32 vector registers, enough to keep the independent chains of two batches in flight
+    static const int LOCAL_STEP_UNROLL = 2;
+#else
+    static const int LOCAL_STEP_UNROLL = 1;
+#endif
+
+    static void localStep(const KernelData& data, int batchBegin, int batchEnd, float* rhs) {
+        if (rhs)
+            computeLocalStepFused<false>(data, batchBegin, batchEnd, (Scalarf4*) rhs);
+        else
+            computeLocalStepFused<true>(data, batchBegin, batchEnd, nullptr);
+    }
+
+    //local step of the batches [batchBegin, batchEnd) in a single pass per batch: gather, deformation gradient,
+    //APD, (R - F) * DT * K and the output of the contributions, either added to rhs or written to the staging area.
+    //the rotation is still built twice, APD needs the one of the last substep and the RHS the updated one.
+    //LOCAL_STEP_UNROLL batches are computed together, the remainder one at a time
+    template <bool staged>
+    static void computeLocalStepFused(const KernelData& data, int batchBegin, int batchEnd, Scalarf4* rhs) {
+
+        const int U = LOCAL_STEP_UNROLL;
+
+        TetBatch<W>* batches = (TetBatch<W>*) data.tetBatches;
+
+        int i = batchBegin;
+        for (; i + U <= batchEnd; i += U)
+        {
+            prefetchBatches(data, batches, i, U, batchEnd);
+
+            Vector3 dx[U][4];
+            for (int u = 0; u < U; u++)
+                computeRHSBatch(data, batches[i + u], dx[u]);
+
+            for (int u = 0; u < U; u++)
+                writeContributions<staged>(data, batches[i + u], i + u, dx[u], rhs);
+        }
+
+        for (; i < batchEnd; i++)
+        {
+            Vector3 dx[4];
+            computeRHSBatch(data, batches[i], dx);
+
+            writeContributions<staged>(data, batches[i], i, dx, rhs);
+        }
+    }
+
+    //prefetches for the group of count batches starting at i: the records of the group PREFETCH_DISTANCE groups ahead,
+    //and the vertices of the next group, whose records are already on the way
+    static inline void prefetchBatches(const KernelData& data, const TetBatch<W>* batches, int i, int count, int batchEnd) {
+
+        for (int b = i + PREFETCH_DISTANCE * count; b < i + (PREFETCH_DISTANCE + 1) * count && b < batchEnd; b++)
+        {
+            const char* record = (const char*) &batches[b];
+            for (size_t offset = 0; offset < sizeof(TetBatch<W>); offset += 64)
+                __builtin_prefetch(record + offset);
+        }
+
+        for (int b = i + count; b < i + 2 * count && b < batchEnd; b++)
+        {
+            const int32_t* next = &batches[b].indices[0][0];
+            for (int k = 0; k < 4 * W; k++)
+            {
+                __builtin_prefetch(data.x + next[k]);
+                __builtin_prefetch(data.y + next[k]);
+                __builtin_prefetch(data.z + next[k]);
+            }
+        }
+    }
+
+    //the local step as it was before the fused kernel, in separate passes over the batches [batchBegin, batchEnd):
+    //the rotations and contributions of all batches go to the staging area first, then the scatter mode adds
+    //them to rhs one lane at a time
+    static void localStepSplit(const KernelData& data, int batchBegin, int batchEnd, float* rhs) {
+
+        TetBatch<W>* batches = (TetBatch<W>*) data.tetBatches;
+
+        for (int i = batchBegin; i < batchEnd; i++)
+        {
+            Vector3 dx[4];
+            computeRHSBatch(data, batches[i], dx);
+
+            writeContributions<true>(data, batches[i], i, dx, nullptr);
+        }
+
+        if (!rhs)
+            return;
+
+        //write results to the corresponding positions in the RHS vector
+        const Scalarf4* staging = (const Scalarf4*) data.staging;
+
+        for (int i = batchBegin; i < batchEnd; i++)
+        {
+            const int lanes = std::min((int) W, (int) data.tetCount - W * i);
+
+            for (int k = 0; k < 4; k++)
+                for (int j = 0; j < lanes; j++)
+                    ((Scalarf4*) rhs)[batches[i].indices[k][j]] += staging[(4 * i + k) * W + j];
+        }
+    }
+
+    //computes the corotated part of the RHS for the W tets of a batch
+    static inline void computeRHSBatch(const KernelData& data, TetBatch<W>& batch, Vector3 dx[4]) {
+
+        Scalar DT[4][3];
+        for (int j = 0; j < 4; j++)
+            for (int k = 0; k < 3; k++)
+                DT[j][k].load(batch.DT[j][k]);
+
+        Vector3 vertices[4];
+        gatherVertices(data, batch.indices, vertices);
+
+        Quaternion q;
+        for (int c = 0; c < 4; c++)
+            q[c].load(batch.quat[c]);
+
+        Scalar K;
+        K.load(batch.K);
+
+        computeRHS(vertices, DT, K, q, dx);
+
+        for (int c = 0; c < 4; c++)
+            q[c].store(batch.quat[c]);
+    }
+
+    //corotated part of the RHS of W tets from their corners, q is the rotation of the last substep and gets updated
+    static inline void computeRHS(const Vector3 vertices[4], const Scalar (&DT)[4][3], const Scalar& K, Quaternion& q,
+            Vector3 dx[4]) {
+
+        // compute F as D_t*x (see Equation (9))
+        Vector3 F1, F2, F3;
+        computeDeformationGradient(vertices, DT, F1, F2, F3);
+
+        APD_Newton(F1, F2, F3, q);
+
+        // R <- R - F
+        Vector3 R1, R2, R3;
+        q.toRotationMatrix(R1, R2, R3);
+        R1 -= F1;
+        R2 -= F2;
+        R3 -= F3;
+
+        //multiply with 2 * dt * dt * DT * K from left
+        for (int k = 0; k < 4; k++)
+            dx[k] = multiplyAdd(multiplyAdd(R1 * DT[k][0], R2, DT[k][1]), R3, DT[k][2]) * K;
+    }
+
+    //columns of F = D_t * x of W tets
+    static inline void computeDeformationGradient(const Vector3 vertices[4], const Scalar (&DT)[4][3],
+            Vector3& F1, Vector3& F2, Vector3& F3) {
+
+        F1 = vertices[0] * DT[0][0];
+        F2 = vertices[0] * DT[0][1];
+        F3 = vertices[0] * DT[0][2];
+
+        for (int j = 1; j < 4; j++)
+        {
+            F1 = multiplyAdd(F1, vertices[j], DT[j][0]);
+            F2 = multiplyAdd(F2, vertices[j], DT[j][1]);
+            F3 = multiplyAdd(F3, vertices[j], DT[j][2]);
+        }
+    }
+
+    //adds the contributions of batch i to rhs, or writes them to its entries of the staging area
+    template <bool staged>
+    static inline void writeContributions(const KernelData& data, const TetBatch<W>& batch, int i, const Vector3 dx[4],
+            Scalarf4* rhs) {
+
+        const Scalar zero = Scalar(0.0f);
+
+        if (staged)
+        {
+            for (int k = 0; k < 4; k++)
+                storeInterleaved(data.staging + 4 * W * (4 * i + k), dx[k].x(), dx[k].y(), dx[k].z(), zero);
+            return;
+        }
+
+        const int lanes = std::min((int) W, (int) data.tetCount - W * i);
+
+        for (int k = 0; k < 4; k++)
+        {
+            //one (x, y, z, 0) vector per lane, transposed in registers and added straight to rhs.
+            //the loop over all W lanes is unrolled, so every lane stays in its own register
+            Scalarf4 contributions[W];
+            interleave(dx[k].x(), dx[k].y(), dx[k].z(), zero, contributions);
+
+            for (int j = 0; j < W; j++)
+                if (j < lanes)
+                    rhs[batch.indices[k][j]] += contributions[j];
+        }
+    }
+
+    //moves the corners of W tets to vector registers
+    static inline void gatherVertices(const KernelData& data, const int32_t (&indices)[4][W], Vector3 p[4]) {
+
+        for (int j = 0; j < 4; j++)
+        {
+            p[j].x().gather(data.x, indices[j]);
+            p[j].y().gather(data.y, indices[j]);
+            p[j].z().gather(data.z, indices[j]);
+        }
+    }
+
+    //computes the APD of W deformation gradients. (Alg. 3 from the paper)
+    static inline void APD_Newton(const Vector3& F1, const Vector3& F2, const Vector3& F3, Quaternion& q) {
+
+        //one iteration is sufficient for plausible results
+        for (int it = 0; it<1; it++)
+        {
+            //transform quaternion to rotation matrix
+            Matrix3 R;
+            q.toRotationMatrix(R);
+
+            //columns of B = RT * F
+            Vector3 B0 = R.transpose() * F1;
+            Vector3 B1 = R.transpose() * F2;
+            Vector3 B2 = R.transpose() * F3;
+
+            Vector3 gradient(B2[1] - B1[2], B0[2] - B2[0], B1[0] - B0[1]);
+
+            //compute Hessian, use the fact that it is symmetric
+            Scalar h00 = B1[1] + B2[2];
+            Scalar h11 = B0[0] + B2[2];
+            Scalar h22 = B0[0] + B1[1];
+            Scalar h01 = Scalar(-0.5) * (B1[0] + B0[1]);
+            Scalar h02 = Scalar(-0.5) * (B2[0] + B0[2]);
+            Scalar h12 = Scalar(-0.5) * (B2[1] + B1[2]);
+
+            //cofactors of H, the determinant is expanded along the first row and the inverse reuses them
+            Scalar c00 = multiplySub(h11 * h22, h12, h12);
+            Scalar c01 = multiplySub(h02 * h12, h01, h22);
+            Scalar c02 = multiplySub(h01 * h12, h02, h11);
+            Scalar c11 = multiplySub(h00 * h22, h02, h02);
+            Scalar c12 = multiplySub(h01 * h02, h00, h12);
+            Scalar c22 = multiplySub(h00 * h11, h01, h01);
+
+            Scalar detH = multiplyAdd(multiplyAdd(h00 * c00, h01, c01), h02, c02);
+
+            //compute symmetric inverse
+            const Scalar factor = Scalar(-0.25) / detH;
+            Vector3 omega(Vector3(c00, c01, c02) * gradient,
+                          Vector3(c01, c11, c12) * gradient,
+                          Vector3(c02, c12, c22) * gradient);
+            omega *= factor;
+
+            omega = Vector3::blend(abs(detH) < 1.0e-9f, gradient * Scalar(-1.0), omega);	//if det(H) = 0 use gradient descent, never happened in our tests, could also be removed
+
+            //instead of clamping just use gradient descent. also works fine and does not require the norm
+            Scalar useGD = blend(omega * gradient > Scalar(0.0), Scalar(1.0), Scalar(-1.0));
+            omega = Vector3::blend(useGD > Scalar(0.0), gradient * Scalar(-0.125), omega);
+
+            Scalar l_omega2 = omega.lengthSquared();
+            const Scalar w = (1.0 - l_omega2) / (1.0 + l_omega2);
+            const Vector3 vec = omega * (2.0 / (1.0 + l_omega2));
+            q = q * Quaternion(vec.x(), vec.y(), vec.z(), w);		//no normalization needed because the Cayley map returs a unit quaternion
+        }
+    }
+
+    //solves the constraint batches [batchBegin, batchEnd) of a phase
+    static void solveConstraints(const KernelData& data, int phase, int batchBegin, int batchEnd) {
+
+        ConstraintBatch<W>* batches = (ConstraintBatch<W>*) data.constraintBatches;
+        const int phaseBegin = data.phaseBatchOffsets[phase];
+
+        for (int b = batchBegin; b < batchEnd; b++)	//forall constraints in this phase
+        {
+            ConstraintBatch<W>& batch = batches[b];
+
+            //lanes of the last batch of a phase may be padding
+            const int lanes = std::min((int) W, data.phaseSizes[phase] - W * (b - phaseBegin));
+
+            //move the positions of W tetrahedrons to vector registers
+            Vector3 p[4];
+            gatherVertices(data, batch.indices, p);
+
+            Vector3 dp[4];
+            computeConstraintBatch(batch, p, dp);
+
+            for (int j = 0; j < 4; j++)
+                p[j] = p[j] + dp[j];
+
+            //write the positions from the vector registers back to the positions array
+            for (int j = 0; j < 4; j++)
+            {
+                float px[W], py[W], pz[W];
+                p[j].x().store(px);
+                p[j].y().store(py);
+                p[j].z().store(pz);
+
+                for (int k = 0; k < lanes; k++)
+                {
+                    int pi = batch.indices[j][k];
+                    data.x[pi] = px[k];
+                    data.y[pi] = py[k];
+                    data.z[pi] = pz[k];
+                }
+            }
+        }
+    }
+
+    //computes the position updates of the Jacobi batches [batchBegin, batchEnd) and writes them to the staging area,
+    //with the same layout as the RHS contributions of the local step
+    static void stageConstraints(const KernelData& data, int batchBegin, int batchEnd) {
+
+        ConstraintBatch<W>* batches = (ConstraintBatch<W>*) data.jacobiBatches;
+        const Scalar zero = Scalar(0.0f);
+
+        for (int i = batchBegin; i < batchEnd; i++)
+        {
+            ConstraintBatch<W>& batch = batches[i];
+
+            Vector3 p[4];
+            gatherVertices(data, batch.indices, p);
+
+            Vector3 dp[4];
+            computeConstraintBatch(batch, p, dp);
+
+            for (int k = 0; k < 4; k++)
+                storeInterleaved(data.staging + 4 * W * (4 * i + k), dp[k].x(), dp[k].y(), dp[k].z(), zero);
+        }
+    }
+
+    static inline void computeConstraintBatch(ConstraintBatch<W>& batch, const Vector3 p[4], Vector3 dp[4]) {
+
+        Scalar invMass[4], restVol, alpha, kappa;
+        for (int j = 0; j < 4; j++)
+            invMass[j].load(batch.invMass[j]);
+        restVol.load(batch.restVolume);
+        alpha.load(batch.alpha);
+        kappa.load(batch.kappa);
+
+        computeConstraint(p, invMass, restVol, alpha, kappa, dp);
+
+        kappa.store(batch.kappa);
+    }
+
+    //updates the Lagrange multipliers of W constraints and computes the position updates of their corners
+    static inline void computeConstraint(const Vector3 p[4], const Scalar invMass[4], const Scalar& restVol,
+            const Scalar& alpha, Scalar& kappa, Vector3 dp[4]) {
+
+        const float eps = 1e-6f;
+
+        //compute the volume using Eq. (14)
+        Vector3 d1 = p[1] - p[0];
+        Vector3 d2 = p[2] - p[0];
+        Vector3 d3 = p[3] - p[0];
+        //compute the gradients (see: supplemental document)
+        Vector3 grad1 = d2 % d3;
+        Vector3 grad2 = d3 % d1;
+        Vector3 grad3 = d1 % d2;
+
+        Scalar volume = grad3 * d3 * (1.0f / 6.0f);
+        Vector3 grad0 = -grad1 - grad2 - grad3;
+
+        //compute the Lagrange multiplier update using Eq. (15)
+        Scalar delta_kappa = alpha;
+        delta_kappa = multiplyAdd(delta_kappa, invMass[0], grad0.lengthSquared());
+        delta_kappa = multiplyAdd(delta_kappa, invMass[1], grad1.lengthSquared());
+        delta_kappa = multiplyAdd(delta_kappa, invMass[2], grad2.lengthSquared());
+        delta_kappa = multiplyAdd(delta_kappa, invMass[3], grad3.lengthSquared());
+
+        delta_kappa = multiplySub(restVol - volume, alpha, kappa) / blend(abs(delta_kappa) < eps, 1.0f, delta_kappa);
+        kappa = kappa + delta_kappa;
+
+        //compute the position updates using Eq. (16)
+        dp[0] = grad0 * delta_kappa * invMass[0];
+        dp[1] = grad1 * delta_kappa * invMass[1];
+        dp[2] = grad2 * delta_kappa * invMass[2];
+        dp[3] = grad3 * delta_kappa * invMass[3];
+    }
+
+    //local step of the instances [instanceBegin, instanceEnd) of a group, tet by tet. the constants of a tet
+    //are broadcast once and reused for all of its blocks of W instances
+    static void localStepInstanced(const KernelData& data, const InstanceGroupData& group, int instanceBegin, int instanceEnd,
+            float* rhs) {
+
+        const Scalar zero = Scalar(0.0f);
+        Scalarf4* groupRHS = (Scalarf4*) rhs + group.vertexOffset;
+
+        for (unsigned int t = 0; t < group.tetCount; t++)
+        {
+            const InstancedTet& tet = group.tets[t];
+
+            Scalar DT[4][3];
+            for (int j = 0; j < 4; j++)
+                for (int k = 0; k < 3; k++)
+                    DT[j][k] = Scalar(tet.DT[j][k]);
+            const Scalar K = Scalar(tet.K);
+
+            float* quat = group.quat + 4 * group.instanceStride * t;
+
+            for (int i = instanceBegin; i < instanceEnd; i += W)
+            {
+                const int lanes = std::min((int) W, instanceEnd - i);
+
+                Vector3 vertices[4];
+                loadInstances(data, group, tet, i, lanes, vertices);
+
+                Quaternion q;
+                for (int c = 0; c < 4; c++)
+                    q[c].load(quat + c * group.instanceStride + i);
+
+                Vector3 dx[4];
+                computeRHS(vertices, DT, K, q, dx);
+
+                for (int c = 0; c < 4; c++)
+                    q[c].store(quat + c * group.instanceStride + i);
+
+                for (int k = 0; k < 4; k++)
+                {
+                    Scalarf4* r = groupRHS + tet.indices[k] * group.instanceCount + i;
+
+                    if (lanes == W)
+                    {
+                        Vector3 sum;
+                        Scalar unused;
+                        loadInterleaved((const float*) r, sum.x(), sum.y(), sum.z(), unused);
+                        sum += dx[k];
+                        storeInterleaved((float*) r, sum.x(), sum.y(), sum.z(), zero);
+                        continue;
+                    }
+
+                    Scalarf4 contributions[W];
+                    storeInterleaved((float*) contributions, dx[k].x(), dx[k].y(), dx[k].z(), zero);
+
+                    for (int j = 0; j < lanes; j++)
+                        r[j] += contributions[j];
+                }
+            }
+        }
+    }
+
+    //Gauss-Seidel over the constraints of the instances [instanceBegin, instanceEnd) of a group. the instances
+    //are independent of each other, so every constraint is solved for all of them before the next one
+    static void solveConstraintsInstanced(const KernelData& data, const InstanceGroupData& group, int instanceBegin, int instanceEnd) {
+
+        for (unsigned int t = 0; t < group.tetCount; t++)
+        {
+            const InstancedTet& tet = group.tets[t];
+
+            Scalar invMass[4];
+            for (int j = 0; j < 4; j++)
+                invMass[j] = Scalar(tet.invMass[j]);
+            const Scalar restVol = Scalar(tet.restVolume);
+            const Scalar alpha = Scalar(tet.alpha);
+
+            float* kappaState = group.kappa + group.instanceStride * t;
+
+            for (int i = instanceBegin; i < instanceEnd; i += W)
+            {
+                const int lanes = std::min((int) W, instanceEnd - i);
+
+                Vector3 p[4];
+                loadInstances(data, group, tet, i, lanes, p);
+
+                Scalar kappa;
+                kappa.load(kappaState + i);
+
+                Vector3 dp[4];
+                computeConstraint(p, invMass, restVol, alpha, kappa, dp);
+
+                kappa.store(kappaState + i);
+
+                for (int j = 0; j < 4; j++)
+                {
+                    p[j] = p[j] + dp[j];
+
+                    int v = group.vertexOffset + tet.indices[j] * group.instanceCount + i;
+
+                    if (lanes == W)
+                    {
+                        p[j].x().store(data.x + v);
+                        p[j].y().store(data.y + v);
+                        p[j].z().store(data.z + v);
+                        continue;
+                    }
+
+                    float px[W], py[W], pz[W];
+                    p[j].x().store(px);
+                    p[j].y().store(py);
+                    p[j].z().store(pz);
+
+                    for (int k = 0; k < lanes; k++)
+                    {
+                        data.x[v + k] = px[k];
+                        data.y[v + k] = py[k];
+                        data.z[v + k] = pz[k];
+                    }
+                }
+            }
+        }
+    }
+
+    //moves the corners of one tet of the instances [i, i + W) to vector registers. they are contiguous,
+    //a block with less than W lanes left repeats its last instance
+    static inline void loadInstances(const KernelData& data, const InstanceGroupData& group, const InstancedTet& tet,
+            int i, int lanes, Vector3 p[4]) {
+
+        for (int j = 0; j < 4; j++)
+        {
+            int v = group.vertexOffset + tet.indices[j] * group.instanceCount + i;
+
+            if (lanes == W)
+            {
+                p[j].x().load(data.x + v);
+                p[j].y().load(data.y + v);
+                p[j].z().load(data.z + v);
+                continue;
+            }
+
+            int32_t indices[W];
+            for (int k = 0; k < W; k++)
+                indices[k] = v + std::min(k, lanes - 1);
+
+            p[j].x().gather(data.x, indices);
+            p[j].y().gather(data.y, indices);
+            p[j].z().gather(data.z, indices);
+        }
+    }
+
+    //the separate operators come from the unit built with -ffp-contract=off, see SolverExpressions.h
+    static void measureExpressions(const KernelData& data, int batchBegin, int batchEnd, bool fused, float* determinants) {
+        if (fused)
+            SolverExpressions<Scalar, true>::measure(data, batchBegin, batchEnd, determinants);
+        else
+            measureSeparateExpressions(data, batchBegin, batchEnd, determinants);
+    }
+
+    //the rows of the triangular solve are too irregular for wide vectors, every instruction set
+    //solves them one (x, y, z, 0) entry at a time with its own encoding of Scalarf4
+    static void solveTriangularRows(const TriangularRows& rows, float* x, int rowBegin, int rowEnd) {
+
+        Scalarf4* x4 = (Scalarf4*) x;
+        const TriangularEntry* entry = rows.entries + rows.offsets[rowBegin];
+
+        for (int r = rowBegin; r < rowEnd; r++) {
+            const TriangularEntry* entriesEnd = rows.entries + rows.offsets[r + 1];
+
+            Scalarf4 sum = x4[rows.targets[r]];
+            for (; entry < entriesEnd; entry++)
+                sum -= Scalarf4(entry->value) * x4[entry->index];
+
+            x4[rows.targets[r]] = sum * Scalarf4(rows.invDiagonal[r]);
+        }
+    }
+
+    //every entry is loaded once and applied to the entries of all instances of its unknown, which are contiguous,
+    //W / 4 instances at a time. the row is accumulated in place, it stays in the cache
+    static void solveTriangularRowsInstanced(const TriangularRows& rows, float* x, int rowBegin, int rowEnd, int instances) {
+
+        const int n = 4 * instances;	//floats per unknown
+        const TriangularEntry* entry = rows.entries + rows.offsets[rowBegin];
+
+        for (int r = rowBegin; r < rowEnd; r++) {
+            const TriangularEntry* entriesEnd = rows.entries + rows.offsets[r + 1];
+            float* target = x + rows.targets[r] * n;
+
+            for (; entry < entriesEnd; entry++) {
+                const float* source = x + entry->index * n;
+                const Scalar value = Scalar(entry->value);
+
+                int j = 0;
+                for (; j + W <= n; j += W) {
+                    Scalar sum, known;
+                    sum.load(target + j);
+                    known.load(source + j);
+                    multiplySub(sum, value, known).store(target + j);
+                }
+                for (; j < n; j += 4) {
+                    Scalarf4 sum, known;
+                    sum.load(target + j);
+                    known.load(source + j);
+                    (sum - Scalarf4(entry->value) * known).store(target + j);
+                }
+            }
+
+            const Scalar invDiagonal = Scalar(rows.invDiagonal[r]);
+
+            int j = 0;
+            for (; j + W <= n; j += W) {
+                Scalar sum;
+                sum.load(target + j);
+                (sum * invDiagonal).store(target + j);
+            }
+            for (; j < n; j += 4) {
+                Scalarf4 sum;
+                sum.load(target + j);
+                (sum * Scalarf4(rows.invDiagonal[r])).store(target + j);
+            }
+        }
+    }
+};
+
+SIMD_NAMESPACE_END
+
+#endif //FEMFORANDROID_SOLVER_KERNELS_H
@@ -0,0 +1,9 @@
+// solver kernels with AVX2 and FMA, 8 lanes. only built for x86 ABIs, with -mavx2 -mfma for this file alone
+#define SIMD_NAMESPACE avx2
+#include "SolverKernels.h"
+
+#include "KernelDispatch.h"
+
+SolverKernelTable KernelDispatch::getAVX2Kernels() {
+    return avx2::SolverKernels<avx2::Scalarf8>::getTable(AVX2Kernels, "AVX2");
+}
@@ -0,0 +1,9 @@
+// solver kernels with AVX-512F, 16 lanes. only built for x86 ABIs, with -mavx512f -mfma for this file alone
+#define SIMD_NAMESPACE avx512
+#include "SolverKernels.h"
+
+#include "KernelDispatch.h"
+
+SolverKernelTable KernelDispatch::getAVX512Kernels() {
+    return avx512::SolverKernels<avx512::Scalarf16>::getTable(AVX512Kernels, "AVX-512");
+}
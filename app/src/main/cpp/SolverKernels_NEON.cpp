@@ -0,0 +1,9 @@
+// solver kernels with NEON, 4 lanes. only built for ARM ABIs
+#define SIMD_NAMESPACE neon
+#include "SolverKernels.h"
+
+#include "KernelDispatch.h"
+
+SolverKernelTable KernelDispatch::getNEONKernels() {
+    return neon::SolverKernels<neon::Scalarf4>::getTable(NEONKernels, "NEON");
+}
@@ -0,0 +1,9 @@
+// solver kernels with SSE4.1, 4 lanes. only built for x86 ABIs
+#define SIMD_NAMESPACE sse4
+#include "SolverKernels.h"
+
+#include "KernelDispatch.h"
+
+SolverKernelTable KernelDispatch::getSSE4Kernels() {
+    return sse4::SolverKernels<sse4::Scalarf4>::getTable(SSE4Kernels, "SSE4.1");
+}
@@ -0,0 +1,10 @@
+// solver kernels in plain C++, the fallback for CPUs without a supported vector unit
+#define SIMD_NAMESPACE scalar
+#define SIMD_SCALAR
+#include "SolverKernels.h"
+
+#include "KernelDispatch.h"
+
+SolverKernelTable KernelDispatch::getScalarKernels() {
+    return scalar::SolverKernels<scalar::Scalarf4>::getTable(ScalarKernels, "scalar");
+}
@@ -0,0 +1,126 @@
+#include "TetBatching.h"
+
+#include <algorithm>
+
+#include "exceptionUtils.h"
+
+void TetBatching::build(const vector<vector<int>>& tets, int vertexCount, int laneWidth, vector<int>& order) {
+
+    int tetCount = (int) tets.size();
+
+    //tets around every vertex in CSR format
+    vector<int> vertexTetOffsets(vertexCount + 1, 0);
+    for (int t = 0; t < tetCount; t++)
+        for (int j = 0; j < 4; j++)
+            vertexTetOffsets[tets[t][j] + 1]++;
+    for (int v = 0; v < vertexCount; v++)
+        vertexTetOffsets[v + 1] += vertexTetOffsets[v];
+
+    vector<int> vertexTets(vertexTetOffsets[vertexCount]);
+    vector<int> fill(vertexTetOffsets.begin(), vertexTetOffsets.end() - 1);
+    for (int t = 0; t < tetCount; t++)
+        for (int j = 0; j < 4; j++)
+            vertexTets[fill[tets[t][j]]++] = t;
+
+    vector<bool> assigned(tetCount, false);
+
+    //number of vertices a free tet shares with the current batch
+    vector<int> score(tetCount, 0);
+    vector<int> touched;
+
+    auto addVertices = [&](int t) {
+        for (int j = 0; j < 4; j++) {
+            int v = tets[t][j];
+            for (int i = vertexTetOffsets[v]; i < vertexTetOffsets[v + 1]; i++) {
+                int u = vertexTets[i];
+                if (assigned[u])
+                    continue;
+                if (score[u] == 0)
+                    touched.push_back(u);
+                score[u]++;
+            }
+        }
+    };
+
+    auto pickBest = [&]() {
+        int best = -1;
+        for (size_t i = 0; i < touched.size(); i++) {
+            int u = touched[i];
+            if (assigned[u])
+                continue;
+            if (best < 0 || score[u] > score[best] || (score[u] == score[best] && u < best))
+                best = u;
+        }
+        return best;
+    };
+
+    auto clearScores = [&]() {
+        for (size_t i = 0; i < touched.size(); i++)
+            score[touched[i]] = 0;
+        touched.clear();
+    };
+
+    int nextFree = 0;
+    auto pickFree = [&]() {
+        while (assigned[nextFree])
+            nextFree++;
+        return nextFree;
+    };
+
+    order.clear();
+    order.reserve(tetCount);
+
+    size_t previousBatch = 0;
+
+    while (order.size() < tetCount) {
+        //seed with the free tet closest to the previous batch
+        clearScores();
+        for (size_t i = previousBatch; i < order.size(); i++)
+            addVertices(order[i]);
+
+        int seed = pickBest();
+        if (seed < 0)
+            seed = pickFree();
+
+        clearScores();
+
+        previousBatch = order.size();
+
+        int t = seed;
+        for (int lane = 0; lane < laneWidth && order.size() < tetCount; lane++) {
+            if (lane > 0) {
+                t = pickBest();
+                if (t < 0)
+                    t = pickFree();
+            }
+
+            assigned[t] = true;
+            order.push_back(t);
+            addVertices(t);
+        }
+    }
+
+    clearScores();
+}
+
+double TetBatching::computeAverageUniqueVertices(const vector<vector<int>>& tets, int laneWidth) {
+
+    if (tets.empty())
+        return 0.0;
+
+    int batchCount = 0;
+    int uniqueCount = 0;
+
+    vector<int> vertices;
+    for (size_t first = 0; first < tets.size(); first += laneWidth) {
+        vertices.clear();
+        for (size_t t = first; t < first + laneWidth && t < tets.size(); t++)
+            vertices.insert(vertices.end(), tets[t].begin(), tets[t].end());
+
+        std::sort(vertices.begin(), vertices.end());
+        uniqueCount += (int) (std::unique(vertices.begin(), vertices.end()) - vertices.begin());
+        batchCount++;
+    }
+
+    return (double) uniqueCount / batchCount;
+}
@@ -0,0 +1,37 @@
+#ifndef FEMFORANDROID_TET_BATCHING_H
+#define FEMFORANDROID_TET_BATCHING_H
+
+#include <utility>
+#include <vector>
+
+#include "exceptionUtils.h"
+
+using namespace std;
+
+// packs tets into SIMD batches. lanes of a batch are filled greedily with the tets sharing the most
+// vertices with the batch so far, and every batch is seeded next to the previous one,
+// so consecutive batches gather overlapping sets of vertices.
+// the result is an order of the tets, batch i consists of the tets order[laneWidth * i ...],
+// only the last batch may be incomplete
+class TetBatching {
+public:
+    static void build(const vector<vector<int>>& tets, int vertexCount, int laneWidth, vector<int>& order);
+
+    //applies an order computed by build to the tets, or to any per-tet data
+    template <typename T>
+    static void apply(vector<T>& tets, const vector<int>& order) {
+
+        my_assert(order.size() == tets.size());
+
+        vector<T> reordered(tets.size());
+        for (size_t i = 0; i < order.size(); i++)
+            std::swap(reordered[i], tets[order[i]]);
+
+        tets.swap(reordered);
+    }
+
+    //average number of distinct vertices of a batch when the tets are packed in the given order
+    static double computeAverageUniqueVertices(const vector<vector<int>>& tets, int laneWidth);
+};
+
+#endif //FEMFORANDROID_TET_BATCHING_H
@@ -0,0 +1,289 @@
+#include "TriangularSolver.h"
+
+#include <algorithm>
+
+#include "exceptionUtils.h"
+
+using namespace Eigen;
+
+TriangularSolver::TriangularSolver() : n(0), rowKernel(&solveRows), instancedRowKernel(&solveRowsInstanced) {
+
+}
+
+void TriangularSolver::Stream::clear() {
+    rowOffsets.clear();
+    rowTargets.clear();
+    rowInvDiagonal.clear();
+    entries.clear();
+    segments.clear();
+    levelCount = 0;
+    parallel = false;
+}
+
+size_t TriangularSolver::Stream::getMemoryFootprint() const {
+    return (rowOffsets.size() + rowTargets.size()) * sizeof(int) + rowInvDiagonal.size() * sizeof(float) +
+           entries.size() * sizeof(Entry) + segments.size() * sizeof(Segment);
+}
+
+TriangularRows TriangularSolver::Stream::getRows() const {
+    TriangularRows rows = { rowOffsets.data(), rowTargets.data(), rowInvDiagonal.data(), entries.data() };
+    return rows;
+}
+
+// row i of L is column i of L^T and vice versa, so both streams are read column by column.
+// forward substitution runs over the rows of L (columns of LT) in ascending order,
+// backward substitution runs over the rows of L^T (columns of L) in descending order
+void TriangularSolver::initialize(const SparseMatrix<float, ColMajor>& L,
+        const SparseMatrix<float, ColMajor>& LT,
+        const PermutationMatrix<Dynamic, Dynamic, int>& permInv, int threadCount) {
+
+    n = (unsigned int) L.outerSize();
+
+    const int* original = permInv.indices().data();
+
+    Stream* streams[2] = { &forward, &backward };
+    const SparseMatrix<float, ColMajor>* matrices[2] = { &LT, &L };
+
+    for (int s = 0; s < 2; s++) {
+        Stream& stream = *streams[s];
+        const SparseMatrix<float, ColMajor>& matrix = *matrices[s];
+
+        stream.clear();
+        stream.rowOffsets.reserve(n + 1);
+        stream.rowTargets.reserve(n);
+        stream.rowInvDiagonal.reserve(n);
+        stream.entries.reserve(matrix.nonZeros() - n);
+
+        stream.rowOffsets.push_back(0);
+
+        for (int r = 0; r < n; r++) {
+            int i = s == 0 ? r : n - 1 - r;
+
+            float diagonal = 0.0f;
+
+            for (SparseMatrix<float, ColMajor>::InnerIterator it(matrix, i); it; ++it)
+                if (it.row() == i)
+                    diagonal = it.value();
+                else {
+                    Entry entry = { original[it.row()], it.value() };
+                    stream.entries.push_back(entry);
+                }
+
+            my_assert(diagonal != 0.0f);
+
+            stream.rowTargets.push_back(original[i]);
+            stream.rowInvDiagonal.push_back(1.0f / diagonal);
+            stream.rowOffsets.push_back((int) stream.entries.size());
+        }
+
+        scheduleStream(stream, threadCount);
+    }
+}
+
+// sorts the rows of the stream by level, the level of a row is the length of the longest chain
+// of rows it depends on, so all rows of one level may be solved at the same time.
+// wide levels become parallel segments, runs of narrow levels are merged into serial segments
+void TriangularSolver::scheduleStream(Stream& stream, int threadCount) {
+
+    int rows = (int) stream.rowTargets.size();
+
+    vector<int> unknownLevel(n, 0);
+    vector<int> rowLevel(rows);
+
+    stream.levelCount = 0;
+
+    for (int r = 0; r < rows; r++) {
+        int level = 0;
+        for (int e = stream.rowOffsets[r]; e < stream.rowOffsets[r + 1]; e++)
+            level = std::max(level, unknownLevel[stream.entries[e].index] + 1);
+
+        rowLevel[r] = level;
+        unknownLevel[stream.rowTargets[r]] = level;
+        stream.levelCount = std::max(stream.levelCount, level + 1);
+    }
+
+    //counting sort, stable so rows of one level keep their solve order
+    vector<int> levelOffsets(stream.levelCount + 1, 0);
+    for (int r = 0; r < rows; r++)
+        levelOffsets[rowLevel[r] + 1]++;
+    for (int l = 0; l < stream.levelCount; l++)
+        levelOffsets[l + 1] += levelOffsets[l];
+
+    vector<int> order(rows);
+    vector<int> levelFill(levelOffsets.begin(), levelOffsets.end() - 1);
+    for (int r = 0; r < rows; r++)
+        order[levelFill[rowLevel[r]]++] = r;
+
+    vector<int> rowOffsets, rowTargets;
+    vector<float> rowInvDiagonal;
+    vector<Entry> entries;
+    rowOffsets.reserve(rows + 1);
+    rowTargets.reserve(rows);
+    rowInvDiagonal.reserve(rows);
+    entries.reserve(stream.entries.size());
+
+    rowOffsets.push_back(0);
+    for (int i = 0; i < rows; i++) {
+        int r = order[i];
+        entries.insert(entries.end(), stream.entries.begin() + stream.rowOffsets[r],
+                stream.entries.begin() + stream.rowOffsets[r + 1]);
+        rowTargets.push_back(stream.rowTargets[r]);
+        rowInvDiagonal.push_back(stream.rowInvDiagonal[r]);
+        rowOffsets.push_back((int) entries.size());
+    }
+
+    stream.rowOffsets.swap(rowOffsets);
+    stream.rowTargets.swap(rowTargets);
+    stream.rowInvDiagonal.swap(rowInvDiagonal);
+    stream.entries.swap(entries);
+
+    stream.segments.clear();
+
+    int serialRows = 0, parallelRows = 0;
+
+    for (int l = 0; l < stream.levelCount; l++) {
+        int rowBegin = levelOffsets[l];
+        int rowEnd = levelOffsets[l + 1];
+
+        bool parallel = threadCount > 1 && rowEnd - rowBegin >= MIN_ROWS_PER_THREAD * threadCount;
+
+        if (parallel)
+            parallelRows += rowEnd - rowBegin;
+        else
+            serialRows += rowEnd - rowBegin;
+
+        if (!parallel && !stream.segments.empty() && !stream.segments.back().parallel)
+            stream.segments.back().rowEnd = rowEnd;
+        else {
+            Segment segment = { rowBegin, rowEnd, parallel };
+            stream.segments.push_back(segment);
+        }
+    }
+
+    //fall back to a single serial segment if the barriers eat up what the parallel levels save
+    int parallelCost = serialRows + parallelRows / std::max(threadCount, 1) +
+            ((int) stream.segments.size() - 1) * BARRIER_COST_IN_ROWS;
+
+    stream.parallel = parallelRows > 0 && parallelCost < rows;
+
+    if (!stream.parallel) {
+        stream.segments.clear();
+        Segment segment = { 0, rows, false };
+        stream.segments.push_back(segment);
+    }
+}
+
+void TriangularSolver::finalize() {
+    forward.clear();
+    backward.clear();
+    n = 0;
+}
+
+void TriangularSolver::setRowKernels(RowKernel kernel, InstancedRowKernel instancedKernel) {
+    rowKernel = kernel ? kernel : &solveRows;
+    instancedRowKernel = instancedKernel ? instancedKernel : &solveRowsInstanced;
+}
+
+void TriangularSolver::solveRows(const TriangularRows& rows, float* x, int rowBegin, int rowEnd) {
+
+    Scalarf4* x4 = (Scalarf4*) x;
+    const Entry* entry = rows.entries + rows.offsets[rowBegin];
+
+    for (int r = rowBegin; r < rowEnd; r++) {
+        const Entry* entriesEnd = rows.entries + rows.offsets[r + 1];
+
+        Scalarf4 sum = x4[rows.targets[r]];
+        for (; entry < entriesEnd; entry++)
+            sum -= Scalarf4(entry->value) * x4[entry->index];
+
+        x4[rows.targets[r]] = sum * Scalarf4(rows.invDiagonal[r]);
+    }
+}
+
+void TriangularSolver::solveRowsInstanced(const TriangularRows& rows, float* x, int rowBegin, int rowEnd, int instances) {
+
+    Scalarf4* x4 = (Scalarf4*) x;
+    const Entry* entry = rows.entries + rows.offsets[rowBegin];
+
+    for (int r = rowBegin; r < rowEnd; r++) {
+        const Entry* entriesEnd = rows.entries + rows.offsets[r + 1];
+        Scalarf4* target = x4 + rows.targets[r] * instances;
+
+        for (; entry < entriesEnd; entry++) {
+            const Scalarf4 value = Scalarf4(entry->value);
+            const Scalarf4* source = x4 + entry->index * instances;
+
+            for (int k = 0; k < instances; k++)
+                target[k] -= value * source[k];
+        }
+
+        for (int k = 0; k < instances; k++)
+            target[k] = target[k] * Scalarf4(rows.invDiagonal[r]);
+    }
+}
+
+void TriangularSolver::solveRange(const Stream& stream, Scalarf4* x, int rowBegin, int rowEnd, int instances) const {
+
+    if (instances == 1)
+        rowKernel(stream.getRows(), (float*) x, rowBegin, rowEnd);
+    else
+        instancedRowKernel(stream.getRows(), (float*) x, rowBegin, rowEnd, instances);
+}
+
+void TriangularSolver::solveStream(const Stream& stream, Scalarf4* x, WorkerPool& pool,
+        int threadIndex, int threadCount, int instances) const {
+
+    for (size_t s = 0; s < stream.segments.size(); s++) {
+        const Segment& segment = stream.segments[s];
+
+        if (segment.parallel) {
+            int rows = segment.rowEnd - segment.rowBegin;
+            int rowBegin = segment.rowBegin + rows * threadIndex / threadCount;
+            int rowEnd = segment.rowBegin + rows * (threadIndex + 1) / threadCount;
+
+            solveRange(stream, x, rowBegin, rowEnd, instances);
+        } else if (threadIndex == 0)
+            solveRange(stream, x, segment.rowBegin, segment.rowEnd, instances);
+
+        if (s + 1 < stream.segments.size())
+            pool.barrier();
+    }
+}
+
+// x holds b on input and the solution on output, both in original (unpermuted) order
+void TriangularSolver::solve(Scalarf4* x, WorkerPool* pool, int instances) const {
+
+    if (pool == nullptr || pool->getThreadCount() <= 1 || !isParallel()) {
+        solveRange(forward, x, 0, n, instances);
+        solveRange(backward, x, 0, n, instances);
+        return;
+    }
+
+    auto task = [this, x, pool, instances](int threadIndex, int threadCount) {
+        solveStream(forward, x, *pool, threadIndex, threadCount, instances);
+        pool->barrier();
+        solveStream(backward, x, *pool, threadIndex, threadCount, instances);
+    };
+
+    pool->run(task);
+}
+
+bool TriangularSolver::isParallel() const {
+    return forward.parallel || backward.parallel;
+}
+
+int TriangularSolver::getLevelCount() const {
+    return forward.levelCount;
+}
+
+unsigned int TriangularSolver::getSize() const {
+    return n;
+}
+
+unsigned int TriangularSolver::getNonZeros() const {
+    return (unsigned int) (forward.entries.size() + backward.entries.size()) + 2 * n;
+}
+
+size_t TriangularSolver::getMemoryFootprint() const {
+    return forward.getMemoryFootprint() + backward.getMemoryFootprint();
+}
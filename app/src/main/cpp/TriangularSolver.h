@@ -0,0 +1,97 @@
+#ifndef FEMFORANDROID_TRIANGULAR_SOLVER_H
+#define FEMFORANDROID_TRIANGULAR_SOLVER_H
+
+#include <vector>
+#include "Eigen/Sparse"
+
+#include "NEON_math.h"
+#include "SolverBatches.h"
+#include "WorkerPool.h"
+
+using namespace std;
+
+// solves L * L^T * x = P * b in place for a Cholesky factor L with fill-in reducing permutation P.
+// both substitutions are flattened at initialization into row streams in solve order,
+// every row is solved in dot product form, so each unknown is written exactly once.
+// the permutation is folded into the stored indices, the vector is never copied into permuted order.
+// rows are sorted by their level in the dependency graph, rows of one level are independent
+// and wide levels are split between the threads of a worker pool with a barrier after each of them.
+// several right hand sides of the same factor are solved in one sweep if the entries of each unknown
+// are stored one after another, so every entry of L is read once for all of them
+class TriangularSolver {
+private:
+    // one off-diagonal entry of a row: original (unpermuted) index of the known unknown and its factor
+    typedef TriangularEntry Entry;
+
+    // solves rows [rowBegin, rowEnd) of a stream
+    typedef void (*RowKernel)(const TriangularRows& rows, float* x, int rowBegin, int rowEnd);
+    typedef void (*InstancedRowKernel)(const TriangularRows& rows, float* x, int rowBegin, int rowEnd, int instances);
+
+    // range of rows solved either by the first thread only or split between all threads
+    struct Segment {
+        int rowBegin, rowEnd;
+        bool parallel;
+    };
+
+    struct Stream {
+        vector<int> rowOffsets;     // rows + 1, range of the row in entries
+        vector<int> rowTargets;     // original index of the unknown solved by the row
+        vector<float> rowInvDiagonal;
+        vector<Entry> entries;
+
+        int levelCount;
+        vector<Segment> segments;
+        bool parallel;
+
+        void clear();
+        size_t getMemoryFootprint() const;
+        TriangularRows getRows() const;
+    };
+
+    unsigned int n;
+
+    Stream forward;
+    Stream backward;
+
+    RowKernel rowKernel;
+    InstancedRowKernel instancedRowKernel;
+
+    // a level narrower than this many rows per thread is not worth a barrier
+    const int MIN_ROWS_PER_THREAD = 64;
+    // rough cost of a barrier measured in solved rows
+    const int BARRIER_COST_IN_ROWS = 16;
+
+    void scheduleStream(Stream& stream, int threadCount);
+
+    static void solveRows(const TriangularRows& rows, float* x, int rowBegin, int rowEnd);
+    static void solveRowsInstanced(const TriangularRows& rows, float* x, int rowBegin, int rowEnd, int instances);
+    void solveRange(const Stream& stream, Scalarf4* x, int rowBegin, int rowEnd, int instances) const;
+    void solveStream(const Stream& stream, Scalarf4* x, WorkerPool& pool,
+            int threadIndex, int threadCount, int instances) const;
+public:
+    TriangularSolver();
+
+    // threadCount is the size of the worker pool the level schedule is planned for
+    void initialize(const Eigen::SparseMatrix<float, Eigen::ColMajor>& L,
+            const Eigen::SparseMatrix<float, Eigen::ColMajor>& LT,
+            const Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int>& permInv,
+            int threadCount = 1);
+    void finalize();
+
+    // replace the built-in row kernels, e.g. by ones compiled for a wider instruction set. null restores them
+    void setRowKernels(RowKernel kernel, InstancedRowKernel instancedKernel);
+
+    // pool may be null, then both substitutions run serially on the calling thread.
+    // with several instances x holds the entries of unknown i of all of them at [i * instances, (i + 1) * instances)
+    void solve(Scalarf4* x, WorkerPool* pool = nullptr, int instances = 1) const;
+
+    bool isParallel() const;
+    int getLevelCount() const;
+
+    unsigned int getSize() const;
+    unsigned int getNonZeros() const;
+    // bytes used by both streams
+    size_t getMemoryFootprint() const;
+};
+
+#endif //FEMFORANDROID_TRIANGULAR_SOLVER_H
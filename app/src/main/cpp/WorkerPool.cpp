@@ -0,0 +1,176 @@
+#include "WorkerPool.h"
+
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "exceptionUtils.h"
+
+extern "C" {
+#include "generalUtils.h"
+}
+
+static inline void cpuRelax() {
+#if defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#elif defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause");
+#endif
+}
+
+// spins until done() and yields the core after every SPIN_ROUND pauses. gives up after maxTime seconds
+template <typename F>
+static bool spinWait(F done, int spinRound, double maxTime) {
+
+    double startTime = 0.0;
+
+    while (!done()) {
+        for (int i = 0; i < spinRound; i++) {
+            cpuRelax();
+            if (done())
+                return true;
+        }
+
+        sched_yield();
+
+        double now = getTime();
+        if (startTime == 0.0)
+            startTime = now;
+        else if (now - startTime > maxTime)
+            return done();
+    }
+
+    return true;
+}
+
+WorkerPool::WorkerPool() : threadCount(1), taskFunction(nullptr), task(nullptr), generation(0),
+        pending(0), sleeping(0), stopping(false), barrierCount(0), barrierGeneration(0) {
+
+    pthread_mutex_init(&wakeMutex, nullptr);
+    pthread_cond_init(&wakeCondition, nullptr);
+}
+
+void WorkerPool::initialize(int threadCount) {
+
+    finalize();
+
+    //more threads than cores only wait for each other
+    threadCount = std::min(std::max(threadCount, 1), getDefaultThreadCount());
+
+    this->threadCount = threadCount;
+
+    generation = 0;
+    pending = 0;
+    sleeping = 0;
+    stopping = false;
+    barrierCount = 0;
+    barrierGeneration = 0;
+
+    workers.resize(threadCount - 1);
+    for (int i = 0; i < workers.size(); i++) {
+        workers[i].pool = this;
+        workers[i].index = i + 1;
+        pthread_check_error(pthread_create(&workers[i].thread, nullptr, thread_entrypoint, &workers[i]));
+    }
+}
+
+void WorkerPool::finalize() {
+
+    if (!workers.empty()) {
+        stopping = true;
+        generation.fetch_add(1);
+
+        pthread_mutex_lock(&wakeMutex);
+        pthread_cond_broadcast(&wakeCondition);
+        pthread_mutex_unlock(&wakeMutex);
+
+        for (int i = 0; i < workers.size(); i++)
+            pthread_check_error(pthread_join(workers[i].thread, nullptr));
+
+        workers.clear();
+    }
+
+    threadCount = 1;
+}
+
+int WorkerPool::getThreadCount() const {
+    return threadCount;
+}
+
+int WorkerPool::getDefaultThreadCount() {
+
+    unsigned int count = std::thread::hardware_concurrency();
+
+    return count > 0 ? (int) count : 1;
+}
+
+void* WorkerPool::thread_entrypoint(void* opaque) {
+
+    Worker* worker = (Worker*) opaque;
+    worker->pool->threadLoop(worker->index);
+    return nullptr;
+}
+
+void WorkerPool::threadLoop(int index) {
+
+    // generation is 0 when the workers are created, so a task posted before this thread started is not lost
+    unsigned int seen = 0;
+
+    while (true) {
+        auto posted = [&]() { return generation.load(memory_order_acquire) != seen; };
+
+        if (!spinWait(posted, SPIN_ROUND, SPIN_TIME)) {
+            pthread_mutex_lock(&wakeMutex);
+            sleeping.fetch_add(1);
+            while (generation.load() == seen)
+                pthread_cond_wait(&wakeCondition, &wakeMutex);
+            sleeping.fetch_sub(1);
+            pthread_mutex_unlock(&wakeMutex);
+        }
+
+        seen = generation.load(memory_order_acquire);
+
+        if (stopping.load())
+            break;
+
+        taskFunction(task, index, threadCount);
+
+        pending.fetch_sub(1, memory_order_acq_rel);
+    }
+}
+
+void WorkerPool::runTask(TaskFunction function, void* task) {
+
+    this->taskFunction = function;
+    this->task = task;
+
+    pending.store(threadCount - 1, memory_order_relaxed);
+    generation.fetch_add(1);
+
+    if (sleeping.load() > 0) {
+        pthread_mutex_lock(&wakeMutex);
+        pthread_cond_broadcast(&wakeCondition);
+        pthread_mutex_unlock(&wakeMutex);
+    }
+
+    function(task, 0, threadCount);
+
+    spinWait([this]() { return pending.load(memory_order_acquire) == 0; }, SPIN_ROUND, HUGE_VAL);
+}
+
+void WorkerPool::barrier() {
+
+    if (threadCount <= 1)
+        return;
+
+    unsigned int barrierSeen = barrierGeneration.load(memory_order_acquire);
+
+    if (barrierCount.fetch_add(1, memory_order_acq_rel) == threadCount - 1) {
+        barrierCount.store(0, memory_order_relaxed);
+        barrierGeneration.fetch_add(1, memory_order_release);
+    } else
+        spinWait([&]() { return barrierGeneration.load(memory_order_acquire) != barrierSeen; }, SPIN_ROUND, HUGE_VAL);
+}
@@ -0,0 +1,83 @@
+#ifndef FEMFORANDROID_WORKER_POOL_H
+#define FEMFORANDROID_WORKER_POOL_H
+
+#include <pthread.h>
+
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+// persistent pool of worker threads for the physics substep.
+// run() executes a task on all threads at once, the calling thread takes part as thread 0,
+// so the tasks are able to synchronize with barrier(). workers spin for a short while
+// after each task because the next one usually follows within the same substep, then they sleep.
+// every wait gives up the core after a few spins, as a thread that is waited for may be waiting for that core.
+// the pool never has more threads than cores
+class WorkerPool {
+private:
+    typedef void (*TaskFunction)(void* task, int threadIndex, int threadCount);
+
+    struct Worker {
+        WorkerPool* pool;
+        int index;
+        pthread_t thread;
+    };
+
+    int threadCount;
+    vector<Worker> workers;
+
+    TaskFunction taskFunction;
+    void* task;
+
+    atomic<unsigned int> generation;
+    atomic<int> pending;
+    atomic<int> sleeping;
+    atomic<bool> stopping;
+
+    pthread_mutex_t wakeMutex;
+    pthread_cond_t wakeCondition;
+
+    // sense reversing barrier
+    atomic<int> barrierCount;
+    atomic<unsigned int> barrierGeneration;
+
+    // pauses between two yields of a wait
+    static const int SPIN_ROUND = 128;
+    // seconds a worker spins for the next task before it sleeps
+    const double SPIN_TIME = 100.0e-6;
+
+    static void* thread_entrypoint(void* opaque);
+    void threadLoop(int index);
+
+    void runTask(TaskFunction function, void* task);
+
+    template <typename F>
+    static void invoke(void* task, int threadIndex, int threadCount) {
+        (*(F*) task)(threadIndex, threadCount);
+    }
+public:
+    WorkerPool();
+
+    // threadCount includes the calling thread, 1 means that everything runs on the caller
+    void initialize(int threadCount);
+    void finalize();
+
+    int getThreadCount() const;
+
+    // f(threadIndex, threadCount) is called once on every thread, returns when all calls are done
+    template <typename F>
+    void run(F& f) {
+        if (threadCount <= 1)
+            f(0, 1);
+        else
+            runTask(&invoke<F>, &f);
+    }
+
+    // may only be called from inside of a task, every thread of the pool has to reach it
+    void barrier();
+
+    static int getDefaultThreadCount();
+};
+
+#endif //FEMFORANDROID_WORKER_POOL_H
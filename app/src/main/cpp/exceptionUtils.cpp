@@ -1,10 +1,14 @@
 #include "exceptionUtils.h"
 
+#include <csignal>
+#include <cstdio>
 #include <stdexcept>
 #include <ios>
-#include <jni.h>
 #include <string>
 
+#ifdef __ANDROID__
+#include <jni.h>
+
 #include <EGL/egl.h>
 
 #include "coffeecatch.h"
@@ -60,6 +64,7 @@ void swallow_cpp_exception_and_throw_java(JNIEnv *env) {
         NewJavaException(env, "java/lang/Error", "Unknown exception type");
     }
 }
+#endif
 
 void my_assert(bool condition) {
 
@@ -78,6 +83,7 @@ void pthread_check_error(int ret) {
     }
 }
 
+#ifdef __ANDROID__
 void eglCheckError(bool condition, const char* functionName) {
 
     if (!condition) {
@@ -88,4 +94,5 @@ void eglCheckError(bool condition, const char* functionName) {
 
         throw std::runtime_error(std::string(error_msg));
     }
-}
\ No newline at end of file
+}
+#endif
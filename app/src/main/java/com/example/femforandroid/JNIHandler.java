@@ -9,4 +9,5 @@ final class JNIHandler {
     static public native void start();
     static public native void stop();
     static public native void destroy();
+    static public native void setMaterial(float density, float youngsModulus, float poissonRatio);
 }